@@ -0,0 +1,37 @@
+#ifndef __BENCH_HPP__
+#define __BENCH_HPP__
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+// Keeps the compiler from dropping a result that is never used
+template <class T> inline void keep(const T &value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// Nanoseconds per call of fn, over as many calls as fit in about minMillis
+// after one warm up call
+template <class F> double nanosPerCall(F &&fn, int64_t minMillis = 200) {
+    fn();
+    uint64_t calls = 0;
+    auto start = std::chrono::steady_clock::now();
+    std::chrono::nanoseconds elapsed{0};
+    for (uint64_t batch = 1;
+         elapsed < std::chrono::milliseconds(minMillis); batch *= 2) {
+        for (uint64_t i = 0; i < batch; ++i) {
+            fn();
+        }
+        calls += batch;
+        elapsed = std::chrono::steady_clock::now() - start;
+    }
+    return (double)elapsed.count() / (double)calls;
+}
+
+// Each suite prints a table of its timings
+void benchTable();
+void benchDates();
+void benchValidators();
+void benchInts();
+
+#endif // __BENCH_HPP__
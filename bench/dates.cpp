@@ -0,0 +1,46 @@
+#include "bench.hpp"
+#include "lib/constants.hpp"
+#include "lib/utils.hpp"
+
+#include <iomanip>
+#include <sstream>
+#include <string>
+
+// toDate as it was before formatDate
+static std::string oldToDate(time_t seconds) {
+    struct tm *time = gmtime(&seconds);
+    std::stringstream date;
+    date << time->tm_year + 1900 << "-" << std::setfill('0') << std::setw(2)
+         << time->tm_mon + 1 << "-" << std::setfill('0') << std::setw(2)
+         << time->tm_mday << " " << std::setfill('0') << std::setw(2)
+         << time->tm_hour << ":" << std::setfill('0') << std::setw(2)
+         << time->tm_min << ":" << std::setfill('0') << std::setw(2)
+         << time->tm_sec;
+    return date.str();
+}
+
+// Compares the outputs every 7777 seconds from 1970 to 2096, then times
+// consecutive seconds, as the logger and the bids ask for them
+void benchDates() {
+    const time_t end = 4000000000;
+    size_t mismatches = 0;
+    char date[DATE_LEN];
+    for (time_t t = 0; t < end; t += 7777) {
+        formatDate(t, date);
+        mismatches += std::string(date, DATE_LEN) != oldToDate(t) ||
+                      toDate(t) != oldToDate(t);
+    }
+    std::printf("%zu mismatches from 1970 to 2096\n", mismatches);
+
+    time_t t = 1700000000;
+    double format = nanosPerCall([&]() {
+        formatDate(t++, date);
+        keep(date);
+    });
+    double wrapped = nanosPerCall([&]() { keep(toDate(t++)); });
+    double old = nanosPerCall([&]() { keep(oldToDate(t++)); });
+    std::printf("%-12s %10s\n", "", "ns/call");
+    std::printf("%-12s %10.1f\n", "formatDate", format);
+    std::printf("%-12s %10.1f\n", "toDate", wrapped);
+    std::printf("%-12s %10.1f\n", "old toDate", old);
+}
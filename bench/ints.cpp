@@ -0,0 +1,84 @@
+#include "bench.hpp"
+#include "lib/utils.hpp"
+
+#include <string>
+#include <vector>
+
+// toInt as it was before from_chars
+static int oldToInt(std::string intStr, uint32_t &num) {
+    try {
+        size_t conv = 0;
+        int64_t resNum = std::stoll(intStr, &conv, 10);
+        if (conv != intStr.length() || resNum < 0 || resNum > INT32_MAX) {
+            return 1;
+        }
+        num = (uint32_t)resNum;
+    } catch (...) {
+        return 1;
+    }
+    return 0;
+}
+
+// Parses the number fields of a few packets, a UID, an AID, a start value, a
+// duration, a file size and the values and times of bids, along with two that
+// are refused, then writes the bids of a record as the SRC replies do
+void benchInts() {
+    const std::vector<std::string> fields = {
+        "103124", "042",  "1500", "3600", "10485760",
+        "103125", "1750", "2961", "12a4", "99999999999"};
+    const std::vector<std::string> edges = {
+        "", "-5", "+5", " 5", "5 ", "00042", "0x10", "1e3",
+        "2147483647", "2147483648", "4294967296"};
+    const std::vector<uint64_t> bids = {103124, 1500, 1700000000, 2961,
+                                        103125, 1750, 1700000420, 3381};
+
+    // stoll skips leading spaces and takes a sign, which toInt refuses
+    size_t mismatches = 0;
+    for (const std::vector<std::string> *set : {&fields, &edges}) {
+        for (const std::string &field : *set) {
+            uint32_t fast = 0, old = 0;
+            int fastRes = toInt(field, fast), oldRes = oldToInt(field, old);
+            if (fastRes != oldRes || (!fastRes && fast != old)) {
+                std::printf("\"%s\": toInt %s, old toInt %s\n",
+                            field.c_str(), fastRes ? "refuses" : "takes",
+                            oldRes ? "refuses" : "takes");
+                ++mismatches;
+            }
+        }
+    }
+    std::printf("%zu mismatches\n\n", mismatches);
+
+    uint32_t num = 0;
+    double fromChars = nanosPerCall([&]() {
+        for (const std::string &field : fields) {
+            keep(toInt(field, num));
+        }
+    });
+    double stoll = nanosPerCall([&]() {
+        for (const std::string &field : fields) {
+            keep(oldToInt(field, num));
+        }
+    });
+    std::string line;
+    double append = nanosPerCall([&]() {
+        line.clear();
+        for (uint64_t value : bids) {
+            line.push_back(' ');
+            appendInt(line, value);
+        }
+        keep(line.data());
+    });
+    double toString = nanosPerCall([&]() {
+        line.clear();
+        for (uint64_t value : bids) {
+            line += " " + std::to_string(value);
+        }
+        keep(line.data());
+    });
+    std::printf("%-16s %10s\n", "", "ns/field");
+    std::printf("%-16s %10.1f\n", "toInt", fromChars / (double)fields.size());
+    std::printf("%-16s %10.1f\n", "old toInt", stoll / (double)fields.size());
+    std::printf("%-16s %10.1f\n", "appendInt", append / (double)bids.size());
+    std::printf("%-16s %10.1f\n", "std::to_string",
+                toString / (double)bids.size());
+}
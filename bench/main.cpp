@@ -0,0 +1,34 @@
+#include "bench.hpp"
+
+#include <functional>
+#include <iostream>
+#include <map>
+#include <string>
+
+static const std::map<std::string, std::function<void()>> suites = {
+    {"table", benchTable},
+    {"dates", benchDates},
+    {"validators", benchValidators},
+    {"ints", benchInts}};
+
+// Runs the suites named in the arguments, or all of them
+int main(int argc, char *argv[]) {
+    for (int i = 1; i < argc; ++i) {
+        if (suites.find(argv[i]) == suites.end()) {
+            std::cerr << "Unknown suite: " << argv[i] << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    for (const auto &[name, suite] : suites) {
+        bool asked = argc == 1;
+        for (int i = 1; i < argc; ++i) {
+            asked = asked || name == argv[i];
+        }
+        if (asked) {
+            std::cout << "== " << name << std::endl;
+            suite();
+            std::cout << std::endl;
+        }
+    }
+    return EXIT_SUCCESS;
+}
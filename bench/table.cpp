@@ -0,0 +1,52 @@
+#include "bench.hpp"
+#include "server/table.hpp"
+
+#include <cstring>
+#include <random>
+#include <vector>
+
+// The loop sweepActive replaced, one auction at a time
+static void sweepScalar(const uint32_t *startTimes, const uint32_t *durations,
+                        const uint8_t *flags, size_t n, uint32_t now,
+                        uint64_t *bitmap) {
+    memset(bitmap, 0, (n + 63) / 64 * sizeof(uint64_t));
+    for (size_t i = 0; i < n; ++i) {
+        if (flags[i] == SLOT_IN_USE &&
+            (int32_t)(now - startTimes[i]) < (int32_t)durations[i]) {
+            bitmap[i / 64] |= 1ULL << (i % 64);
+        }
+    }
+}
+
+// Sweeps columns of up to 1M auctions, far more than MAX_AUCTIONS, to see how
+// the kernel scales. About a third of them are active.
+void benchTable() {
+    const uint32_t now = 1700000000;
+    std::mt19937 rng(38);
+    auto next = [&rng](uint32_t bound) { return (uint32_t)rng() % bound; };
+    std::printf("%10s %12s %12s\n", "auctions", "sweep (us)", "scalar (us)");
+    for (size_t n : {1000UL, 10000UL, 100000UL, 1000000UL}) {
+        std::vector<uint32_t> startTimes(n), durations(n);
+        std::vector<uint8_t> flags(n);
+        for (size_t i = 0; i < n; ++i) {
+            startTimes[i] = now - next(100000);
+            durations[i] = next(100000);
+            uint32_t kind = next(8);
+            flags[i] = kind == 0 ? 0 : kind == 1 ? SLOT_IN_USE | SLOT_CLOSED
+                                                 : SLOT_IN_USE;
+        }
+        std::vector<uint64_t> fast((n + 63) / 64), slow((n + 63) / 64);
+        double sweep = nanosPerCall([&]() {
+            sweepActive(startTimes.data(), durations.data(), flags.data(), n,
+                        now, fast.data());
+            keep(fast[0]);
+        });
+        double scalar = nanosPerCall([&]() {
+            sweepScalar(startTimes.data(), durations.data(), flags.data(), n,
+                        now, slow.data());
+            keep(slow[0]);
+        });
+        std::printf("%10zu %12.2f %12.2f%s\n", n, sweep / 1000, scalar / 1000,
+                    fast == slow ? "" : "  MISMATCH");
+    }
+}
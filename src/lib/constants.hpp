@@ -7,10 +7,20 @@
 #define DEFAULT_AS_PORT "58075"
 
 #define FILE_BUFFER_SIZE (1024)
+#define MAX_FILE_BUFFER_SIZE (1 << 20)
 #define MAX_FILE_SIZE (10000000)
 #define MAX_FILE_SIZE_DIGS (8)
 #define MAX_FILE_NAME_LEN (24)
 #define FILE_EXTENSION_LEN (3)
+#define PARTIAL_ASSET_SUFFIX ".part" // after the AID, while downloading
+#define UPLOAD_CHUNK_SIZE (1 << 20) // bigger assets are uploaded in chunks
+#define UPLOAD_STREAMS (4)          // connections a chunked upload uses
+#define UPLOAD_RETRIES (3)          // of each chunk
+#define UPLOAD_TOKEN_LEN (8)
+#define UPLOAD_STAGING_PREFIX ".upload_" // followed by the token
+#define MAX_UPLOADS (16) // staged on the server at a time
+#define UPLOAD_TIMEOUT_SECS (60) // without a chunk, then dropped
+#define CRC_LEN (8) // hexadecimal digits
 
 #define PACKET_ID_LEN (3)
 #define MAX_STATUS_LEN (3)
@@ -25,11 +35,33 @@
 #define MAX_DURATION_DIGS (5)
 #define CAL_DATE_LEN (10)
 #define TIME_DATE_LEN (8)
+#define DATE_LEN (CAL_DATE_LEN + 1 + TIME_DATE_LEN)
+#define SECS_PER_DAY (24 * 60 * 60)
 #define MAX_BIDS_LISTINGS (50)
+#define MAX_PAGE_SIZE (200) // auctions in a page, to fit in one datagram
+#define MAX_PAGE_SIZE_DIGS (3)
+#define AUCTION_SHARD_DIGITS (2) // up to 100 auctions per shard directory
+#define STORAGE_LAYOUT_VERSION (2)
+#define LAYOUT_FILE "layout.txt"
+#define SNAPSHOT_FILE "table.bin"
+#define SNAPSHOT_INTERVAL_SECS (60)
 
 #define READ_TIMEOUT_SECS (15)
+#define UDP_RTO_MS (100) // first wait for a UDP reply, doubled on each retry
+#define UDP_MAX_RTO_MS (3000U)
+#define UDP_RETRIES (6)
+#define BATCH_PARALLELISM (16) // requests of a script in flight at a time
 #define WRITE_TIMEOUT_SECS (10 * 60) // 10 minutes
 #define MAX_TCP_QUEUE (5)
 #define MAX_TCP_CONNS (50)
+#define ACCEPT_PAUSE_MS (100) // when out of file descriptors
+#define DRAIN_TIMEOUT_MS (20) // of a refused connection, after its ERR
+#define REPLY_CACHE_TTL_MS (3000)
+#define REPLY_CACHE_SLOTS (1024) // clients with a cached reply, at most
+
+#define LOG_RECORD_LEN (240)
+#define LOG_RING_RECORDS (1024)  // per thread
+#define LOG_RATE_LIMIT (10000)   // records per second and thread
+#define LOG_DRAIN_INTERVAL_MS (10)
 
 #endif // __CONSTANTS_HPP__
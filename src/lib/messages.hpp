@@ -24,6 +24,7 @@
 #define SIGACTION_ERR "[ERR] Failed to set signal action."
 #define SENDTO_ERR "[ERR] Failed to send message via UDP."
 #define RECVFROM_ERR "[ERR] Failed to receive message via UDP."
+#define UDP_TIMEOUT_ERR "[ERR] The server did not answer via UDP."
 #define WRITE_ERR "[ERR] Failed to send message via TCP."
 #define READ_ERR "[ERR] Failed to receive message via TCP."
 #define FILE_ERR "[ERR] Failed to process the file."
@@ -33,12 +34,45 @@
 #define UDP_BIND_ERR "[ERR] Failed to bind UDP address: "
 #define TCP_LISTEN_ERR "[ERR] An error occured while executing listen."
 #define TCP_ACCEPT_ERR "[ERR] Failed to accept a TCP connection."
+#define EPOLL_ERR "[ERR] An error occured while calling epoll: "
+#define BATCH_FILE_ERR "[ERR] Failed to open the script: "
 #define SELECT_ERR "[ERR] An error occured while calling select(): "
+#define METRICS_ERR "[ERR] Failed to allocate the shared metrics: "
+#define OPTION_ERR(opt, arg)                                                   \
+    "[ERR] Invalid value '" << arg << "' for the option -" << (char)opt       \
+                            << ". See -h for the expected values."
+#define CONFIG_FILE_ERR "[ERR] Failed to open the config file: "
+#define CONFIG_LINE_ERR(path, lineNum)                                         \
+    "[ERR] Invalid option in the config file " << path << ", line " << lineNum \
+                                               << "."
+#define DATA_DIR_ERR "[ERR] Failed to enter the data directory: "
+#define MIGRATION_ERR "[ERR] Failed to migrate the data base: "
+#define TABLE_ERR "[ERR] Failed to allocate the shared auction table: "
+#define SNAPSHOT_ERR "[ERR] Failed to write the auction table snapshot."
+#define LOADED_AUCTIONS(numAuctions, source, millis)                           \
+    "[INFO] Loaded " << numAuctions << " auctions from the " << (source)      \
+                     << " in " << millis << " ms."
+#define RECOVERY_ERR "[ERR] Failed to recover the data base: "
+#define RECOVERY_DONE(numDiscarded, numRepaired)                               \
+    "[INFO] Discarded " << numDiscarded                                        \
+                        << " partially opened auctions and repaired "         \
+                        << numRepaired << " auctions."
+#define MIGRATION_DONE(numAuctions, numUsers)                                  \
+    "[INFO] Migrated " << numAuctions << " auctions and " << numUsers         \
+                       << " users to the sharded data base layout."
 
 #define TCP_CONNECTION "Receiving TCP connection from "
+#define TCP_UNSUBSCRIBED "Closing the subscription of "
 #define TCP_REFUSE "Timed out TCP connection from "
+#define TCP_BUSY "Refused TCP connection (server busy) from "
+#define TCP_ACCEPT_PAUSED "Out of file descriptors, pausing accepts: "
+#define REQUEST_SHED(className)                                                \
+    "Refused a request over the " << className << " rate limit"
+#define CHUNK_CRC_MISMATCH(offset)                                             \
+    "The checksum of the chunk uploaded at byte " << offset << " did not match"
 #define UDP_CONNECTION "Receiving UDP connection from "
 #define UNKNOWN_MSG "The received message doesn't belong to the protocol."
+#define CACHED_REPLY "Sent the same reply again to a retransmitted request"
 #define UNEXPECTED_COMMAND_ERR(commandName)                                    \
     "The command '" << commandName << "' is not supported by this application."
 #define LOGIN_ERR                                                              \
@@ -74,6 +108,11 @@
     "value with up to 5 digits."
 #define OPEN_OK(aid) "New auction with the id of '" << aid << "' was created."
 #define OPEN_NOK "Could not open the auction."
+#define UPLOAD_PROGRESS "Upload is in progress..."
+#define UPLOAD_NOK "The server could not take the asset right now."
+#define UPLOAD_CHUNK_ERR "Failed to upload the asset."
+#define UPLOAD_DROPPED                                                         \
+    "The server dropped the upload, it went too long without a chunk."
 #define AID_ERR "Invalid auction id. Expected a 3 digit number."
 #define CLOSE_OK "Auction closed successfully."
 #define CLOSE_EAU "The auction you tried to close does not exist."
@@ -86,6 +125,17 @@
     "You do not have any auctions in which you have placed a bid."
 #define LIST_OK "Here are all the auctions:"
 #define LIST_NOK "There are no auctions."
+#define LIST_ACTIVE_NOK "There are no active auctions."
+#define LIST_FILTER_ERR "The only filter of the list is 'active'."
+#define LIST_RANGE_NOK "There are no auctions in that range."
+#define LIST_ENDING_NOK "No active auction ends within that time."
+#define LIST_ENDING_ERR                                                        \
+    "Invalid number of seconds. Expected a positive value with up to 5 "       \
+    "digits."
+#define LIST_RANGE_ERR "The first auction id cannot be after the last one."
+#define FILTER_ERR                                                             \
+    "Invalid filter. Expected 'active', 'range <AID> <AID>' or 'ending "       \
+    "<seconds>'."
 #define BID_NOK "The auction you tried to bid on is not active."
 #define BID_ACC "Your bid was accepted."
 #define BID_REF "Your bid was refused. You need to place a larger bid."
@@ -98,6 +148,33 @@
         << std::endl                                                           \
         << "The file is stored at: ./" << fName << std::endl                   \
         << "It occupies '" << fSize << "' bytes"
+#define SHOW_ASSET_RESUMED(offset)                                             \
+    "Resuming the transfer from byte " << offset << "."
+#define SHOW_ASSET_PARTIAL                                                     \
+    "The transfer was interrupted, show_asset resumes it from where it "       \
+    "stopped."
+#define SHOW_ASSET_RESTARTED                                                   \
+    "The partial file is not of this asset, transfering it again."
 #define SHOW_RECORD_NOK "The specified auction does not exist."
+#define WATCH_OK "Watching for events, press Enter to stop:"
+#define WATCH_NOK "The auction you tried to watch does not exist."
+#define WATCH_END "The server closed the subscription."
+#define EVENT_OPENED(aid, uid, value)                                          \
+    "Auction '" << aid << "' was opened by '" << uid                           \
+                << "' with a start value of " << value << "."
+#define EVENT_BID(aid, uid, value)                                             \
+    "User '" << uid << "' placed the highest bid of " << value                 \
+             << " on auction '" << aid << "'."
+#define EVENT_CLOSED(aid) "Auction '" << aid << "' is now closed."
+#define STATS_OK "Server metrics:"
+#define STATS_NOK "The server only reports its metrics to local users."
+#define BATCH_RESULT(lineNum, command, status, millis)                         \
+    "[" << lineNum << "] " << command << ": " << status << " in " << millis    \
+        << " ms"
+#define BATCH_SUMMARY(count, failed, millis, p50, p99, max)                    \
+    "Ran " << count << " commands (" << failed << " without a reply) in "      \
+           << millis << " ms. Latency p50 " << p50 << " ms, p99 " << p99      \
+           << " ms, max " << max << " ms."
+#define BATCH_EMPTY "The script has no commands."
 
 #endif // __MESSAGES_HPP__
@@ -3,12 +3,18 @@
 #include "utils.hpp"
 
 #include <algorithm>
+#include <cerrno>
+#include <charconv>
 #include <ctime>
+#include <fcntl.h>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
 #include <netdb.h>
 #include <string>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
 std::string UDPPacket::readString(std::string &buffer) {
@@ -56,21 +62,89 @@ int UDPPacket::readAuctions(std::string &buffer,
             return 1;
         }
         std::string aid = readString(buffer);
-        if (checkAID(aid) || readSpace(buffer)) {
+        Auction newAuction;
+        if (!isAID(aid) || toInt(aid, newAuction.AID) || readSpace(buffer)) {
             return 1;
         }
         uint32_t state;
-        if (toInt(readString(buffer), state) || (state != 0 && state != 1)) {
+        if (toInt(readString(buffer), state, 1, 1)) {
             return 1;
         }
-        Auction newAuction;
-        newAuction.AID = aid;
         newAuction.state = (uint8_t)state;
         auctions.push_back(newAuction);
     }
     return 0;
 }
 
+int UDPPacket::readRecord(std::string &buffer, std::vector<Bid> &bids,
+                          std::string &calEndDate, std::string &timeEndDate,
+                          uint32_t &endSecTime) {
+    if (!buffer.empty() && buffer.front() == '\n') {
+        return readNewLine(buffer);
+    }
+    int i = 0;
+    do {
+        if (readSpace(buffer)) {
+            return 1;
+        }
+        std::string type = readString(buffer);
+        if (type == "B") {
+            if (readSpace(buffer)) {
+                return 1;
+            }
+            Bid bid;
+            std::string bidderUID = readString(buffer);
+            if (!isUID(bidderUID) || toInt(bidderUID, bid.bidderUID) ||
+                readSpace(buffer)) {
+                return 1;
+            }
+            std::string strValue = readString(buffer);
+            if (toInt(strValue, bid.value, MAX_VAL_DIGS, MAX_VAL) ||
+                readSpace(buffer)) {
+                return 1;
+            }
+            std::string calDate = readString(buffer);
+            if (!isCalDate(calDate) || readSpace(buffer)) {
+                return 1;
+            }
+            std::string timeDate = readString(buffer);
+            if (!isTimeDate(timeDate) ||
+                parseDate(calDate + " " + timeDate, bid.time) ||
+                readSpace(buffer)) {
+                return 1;
+            }
+            std::string strSecTime = readString(buffer);
+            if (toInt(strSecTime, bid.secTime, MAX_DURATION_DIGS,
+                      MAX_DURATION)) {
+                return 1;
+            }
+            bids.push_back(bid);
+        } else if (type == "E") {
+            if (readSpace(buffer)) {
+                return 1;
+            }
+            calEndDate = readString(buffer);
+            if (!isCalDate(calEndDate) || readSpace(buffer)) {
+                return 1;
+            }
+            timeEndDate = readString(buffer);
+            if (!isTimeDate(timeEndDate) || readSpace(buffer)) {
+                return 1;
+            }
+            std::string strEndSecTime = readString(buffer);
+            if (toInt(strEndSecTime, endSecTime, MAX_DURATION_DIGS,
+                      MAX_DURATION)) {
+                return 1;
+            }
+            return readNewLine(buffer);
+        } else {
+            return 1;
+        }
+    } while (!buffer.empty() && buffer.front() != '\n' &&
+             ++i <= MAX_BIDS_LISTINGS);
+    return readNewLine(buffer);
+}
+
 std::string TCPPacket::readString(const int fd, const size_t lim) {
     std::string str = "";
     size_t i = 0;
@@ -115,57 +189,71 @@ int TCPPacket::readNewLine(const int fd) {
 }
 
 int TCPPacket::sendFile(std::string fPath, const int fd) {
-    std::ifstream file(fPath, std::ios::in | std::ios::binary);
-    if (!file) {
+    int file = open(fPath.c_str(), O_RDONLY);
+    if (file == -1) {
         std::cerr << "Failed to open file: " << fPath << std::endl;
         return 1;
     }
     std::filesystem::path p(fPath);
     std::string fName = p.filename();
-    size_t fSize = (size_t)std::filesystem::file_size(p);
-    if (fSize == 0 || fSize > MAX_FILE_SIZE) {
-        file.close();
+    struct stat st;
+    if (fstat(file, &st) == -1 || st.st_size == 0 ||
+        st.st_size > MAX_FILE_SIZE) {
+        close(file);
         std::cerr << FILE_SIZE_ERR << std::endl;
         return 1;
     }
-    std::string msg = fName + " " + std::to_string(fSize) + " ";
+    size_t fSize = (size_t)st.st_size;
+    std::string msg = fName + " ";
+    appendInt(msg, fSize);
+    msg += " ";
     if (sendTCPPacket(msg.c_str(), msg.length(), fd)) {
-        file.close();
+        close(file);
         std::cerr << FILE_ERR << std::endl;
         return 1;
     }
 
-    ssize_t read;
-    ssize_t sent;
-    char buffer[FILE_BUFFER_SIZE];
-    std::cout << "Upload is in progress...";
-    while (file) {
-        file.read(buffer, FILE_BUFFER_SIZE);
-        read = (ssize_t)file.gcount();
-        sent = 0;
-        while (sent < read) {
-            ssize_t n = write(fd, buffer + sent, (size_t)(read - sent));
-            if (n < 0) {
-                file.close();
-                std::cerr << FILE_ERR << std::endl;
-                return 1;
-            }
-            sent += n;
-        }
+    std::cout << UPLOAD_PROGRESS;
+    if (sendFileRange(file, 0, fSize, fd)) {
+        close(file);
+        return 1;
     }
     std::cout << " 100%" << std::endl;
+    close(file);
     char newLine = '\n';
     if (sendTCPPacket(&newLine, 1, fd)) {
-        file.close();
         std::cerr << FILE_ERR << std::endl;
         return 1;
     }
-    file.close();
     return 0;
 }
 
-int TCPPacket::receiveFile(std::string fName, size_t fSize, const int fd) {
-    std::ofstream file(fName);
+// The kernel copies the file to the socket, without going through a buffer
+int TCPPacket::sendFileRange(const int fileFD, off_t offset, size_t length,
+                             const int fd) {
+    while (length > 0) {
+        ssize_t sent = sendfile(fd, fileFD, &offset, length);
+        if (sent <= 0) {
+            std::cerr << FILE_ERR << std::endl;
+            return 1;
+        }
+        length -= (size_t)sent;
+    }
+    return 0;
+}
+
+int TCPPacket::receiveFile(std::string fName, size_t fSize, const int fd,
+                           size_t offset) {
+    std::ofstream file;
+    if (offset == 0) {
+        file.open(fName);
+    } else {
+        std::error_code err;
+        std::filesystem::resize_file(fName, offset, err);
+        if (!err) {
+            file.open(fName, std::ios::out | std::ios::app);
+        }
+    }
     if (!file.good() || !file.is_open()) {
         std::cerr << FILE_ERR << std::endl;
         return 1;
@@ -174,17 +262,17 @@ int TCPPacket::receiveFile(std::string fName, size_t fSize, const int fd) {
     size_t remaining = fSize;
     size_t toRead;
     ssize_t gotRead;
-    char buffer[FILE_BUFFER_SIZE];
+    std::vector<char> buffer(fileBufferSize);
     std::cout << "Download is in progress...";
     while (remaining > 0) {
-        toRead = std::min(remaining, (size_t)FILE_BUFFER_SIZE);
-        gotRead = read(fd, buffer, toRead);
+        toRead = std::min(remaining, fileBufferSize);
+        gotRead = read(fd, buffer.data(), toRead);
         if (gotRead <= 0) {
             file.close();
             std::cerr << FILE_ERR << std::endl;
             return 1;
         }
-        file.write(buffer, gotRead);
+        file.write(buffer.data(), gotRead);
         if (!file.good()) {
             file.close();
             std::cerr << FILE_ERR << std::endl;
@@ -197,6 +285,22 @@ int TCPPacket::receiveFile(std::string fName, size_t fSize, const int fd) {
     return 0;
 }
 
+static std::string toHex(uint32_t num) {
+    char hex[CRC_LEN + 1];
+    snprintf(hex, sizeof(hex), "%08x", num);
+    return hex;
+}
+
+// Returns 1 unless the string has exactly CRC_LEN hexadecimal digits
+static int fromHex(std::string_view str, uint32_t &num) {
+    if (str.length() != CRC_LEN) {
+        return 1;
+    }
+    const char *end = str.data() + str.length();
+    auto [ptr, ec] = std::from_chars(str.data(), end, num, 16);
+    return ec != std::errc() || ptr != end;
+}
+
 // Packet methods: used by the user side
 
 std::string LINPacket::serialize() {
@@ -237,8 +341,11 @@ int RURPacket::deserialize(std::string &buffer) {
 
 int OPAPacket::serialize(const int fd) {
     std::string msg = std::string(ID) + " " + UID + " " + password + " " +
-                      auctionName + " " + std::to_string(startValue) + " " +
-                      std::to_string(duration) + " ";
+                      auctionName + " ";
+    appendInt(msg, startValue);
+    msg += " ";
+    appendInt(msg, duration);
+    msg += " ";
     return sendTCPPacket(msg.c_str(), msg.length(), fd) ||
            sendFile(assetfPath, fd);
 }
@@ -256,16 +363,74 @@ int ROAPacket::deserialize(const int fd) {
             return 1;
         }
         AID = readString(fd, AID_LEN);
-        if (checkAID(AID)) {
+        if (!isAID(AID)) {
             return 1;
         }
     }
     return readNewLine(fd);
 }
 
-int CLSPacket::serialize(const int fd) {
+int UPSPacket::serialize(const int fd) {
+    std::string msg = std::string(ID) + " " + UID + " " + password + " ";
+    appendInt(msg, assetfSize);
+    msg += "\n";
+    return sendTCPPacket(msg.c_str(), msg.length(), fd);
+}
+
+int RUSPacket::deserialize(const int fd) {
+    if (readString(fd, PACKET_ID_LEN) != std::string(ID) || readSpace(fd)) {
+        return 1;
+    }
+    status = readString(fd, MAX_STATUS_LEN);
+    if (status.empty()) {
+        return 1;
+    }
+    if (status == "OK") {
+        if (readSpace(fd) || toInt(readString(fd, UPLOAD_TOKEN_LEN), token,
+                                   UPLOAD_TOKEN_LEN)) {
+            return 1;
+        }
+    }
+    return readNewLine(fd);
+}
+
+int UPCPacket::serialize(const int fd) {
     std::string msg =
-        std::string(ID) + " " + UID + " " + password + " " + AID + "\n";
+        std::string(ID) + " " + toDigits(token, UPLOAD_TOKEN_LEN) + " ";
+    appendInt(msg, offset);
+    msg += " ";
+    appendInt(msg, length);
+    msg += " " + toHex(crc) + " ";
+    char newLine = '\n';
+    return sendTCPPacket(msg.c_str(), msg.length(), fd) ||
+           sendTCPPacket(data.c_str(), data.length(), fd) ||
+           sendTCPPacket(&newLine, 1, fd);
+}
+
+int RUCPacket::deserialize(const int fd) {
+    if (readString(fd, PACKET_ID_LEN) != std::string(ID) || readSpace(fd)) {
+        return 1;
+    }
+    status = readString(fd, MAX_STATUS_LEN);
+    return status.empty() || readNewLine(fd);
+}
+
+int OPCPacket::serialize(const int fd) {
+    std::string msg = std::string(ID) + " " + UID + " " + password + " " +
+                      auctionName + " ";
+    appendInt(msg, startValue);
+    msg += " ";
+    appendInt(msg, duration);
+    msg += " " + assetfName + " " + toDigits(token, UPLOAD_TOKEN_LEN) + "\n";
+    return sendTCPPacket(msg.c_str(), msg.length(), fd);
+}
+
+std::string CLSPacket::message() {
+    return std::string(ID) + " " + UID + " " + password + " " + AID + "\n";
+}
+
+int CLSPacket::serialize(const int fd) {
+    std::string msg = this->message();
     return sendTCPPacket(msg.c_str(), msg.length(), fd);
 }
 
@@ -329,9 +494,64 @@ int RLSPacket::deserialize(std::string &buffer) {
     return readNewLine(buffer);
 }
 
+std::string LPGPacket::serialize() {
+    return std::string(ID) + " " + toDigits(cursor, AID_LEN) + " " +
+           std::to_string(pageSize) + " " + std::to_string(activeOnly) + "\n";
+}
+
+int RLPPacket::deserialize(std::string &buffer) {
+    if (readString(buffer) != std::string(ID) || readSpace(buffer)) {
+        return 1;
+    }
+    status = readString(buffer);
+    if (status.empty()) {
+        return 1;
+    }
+    if (status == "OK") {
+        std::string strNext;
+        if (readSpace(buffer) || !isAID(strNext = readString(buffer)) ||
+            toInt(strNext, next) || readAuctions(buffer, auctions)) {
+            return 1;
+        }
+    }
+    return readNewLine(buffer);
+}
+
+std::string LFLPacket::serialize() {
+    std::string msg = std::string(ID) + " " + filter;
+    if (filter == FILTER_RANGE) {
+        msg += " " + toDigits(from, AID_LEN) + " " + toDigits(to, AID_LEN);
+    } else if (filter == FILTER_ENDING) {
+        msg += " ";
+        appendInt(msg, within);
+    }
+    return msg + "\n";
+}
+
+int RLFPacket::deserialize(std::string &buffer) {
+    if (readString(buffer) != std::string(ID) || readSpace(buffer)) {
+        return 1;
+    }
+    status = readString(buffer);
+    if (status.empty()) {
+        return 1;
+    }
+    if (status == "OK" && readAuctions(buffer, auctions)) {
+        return 1;
+    }
+    return readNewLine(buffer);
+}
+
+std::string BIDPacket::message() {
+    std::string msg =
+        std::string(ID) + " " + UID + " " + password + " " + AID + " ";
+    appendInt(msg, value);
+    msg += "\n";
+    return msg;
+}
+
 int BIDPacket::serialize(const int fd) {
-    std::string msg = std::string(ID) + " " + UID + " " + password + " " + AID +
-                      " " + std::to_string(value) + "\n";
+    std::string msg = this->message();
     return sendTCPPacket(msg.c_str(), msg.length(), fd);
 }
 
@@ -361,12 +581,12 @@ int RSAPacket::deserialize(const int fd) {
             return 1;
         }
         assetfName = readString(fd, MAX_FILE_NAME_LEN);
-        if (checkFileName(assetfName) || readSpace(fd)) {
+        if (!isFileName(assetfName) || readSpace(fd)) {
             return 1;
         }
         std::string strfSize = readString(fd, MAX_FILE_SIZE_DIGS);
-        if (toInt(strfSize, assetfSize) || assetfSize == 0 ||
-            assetfSize > MAX_FILE_SIZE || readSpace(fd)) {
+        if (toInt(strfSize, assetfSize, MAX_FILE_SIZE_DIGS, MAX_FILE_SIZE) ||
+            assetfSize == 0 || readSpace(fd)) {
             return 1;
         }
         if (receiveFile(assetfName, assetfSize, fd)) {
@@ -376,6 +596,97 @@ int RSAPacket::deserialize(const int fd) {
     return readNewLine(fd);
 }
 
+int SARPacket::serialize(const int fd) {
+    std::string msg = std::string(ID) + " " + AID + " ";
+    appendInt(msg, offset);
+    msg += " ";
+    appendInt(msg, length);
+    msg += "\n";
+    return sendTCPPacket(msg.c_str(), msg.length(), fd);
+}
+
+int RSRPacket::deserialize(const int fd) {
+    if (readString(fd, PACKET_ID_LEN) != std::string(ID) || readSpace(fd)) {
+        return 1;
+    }
+    status = readString(fd, MAX_STATUS_LEN);
+    if (status.empty()) {
+        return 1;
+    }
+    if (status == "OK") {
+        if (readSpace(fd)) {
+            return 1;
+        }
+        assetfName = readString(fd, MAX_FILE_NAME_LEN);
+        if (!isFileName(assetfName) || readSpace(fd)) {
+            return 1;
+        }
+        if (toInt(readString(fd, MAX_FILE_SIZE_DIGS), assetfSize,
+                  MAX_FILE_SIZE_DIGS, MAX_FILE_SIZE) ||
+            assetfSize == 0 || readSpace(fd)) {
+            return 1;
+        }
+        if (toInt(readString(fd, MAX_FILE_SIZE_DIGS), offset,
+                  MAX_FILE_SIZE_DIGS, assetfSize) ||
+            readSpace(fd)) {
+            return 1;
+        }
+        if (toInt(readString(fd, MAX_FILE_SIZE_DIGS), length,
+                  MAX_FILE_SIZE_DIGS, assetfSize - offset) ||
+            readSpace(fd)) {
+            return 1;
+        }
+        if (length > 0 && receiveFile(partPath, length, fd, offset)) {
+            return 1;
+        }
+    }
+    return readNewLine(fd);
+}
+
+int SUBPacket::serialize(const int fd) {
+    std::string msg = std::string(ID) + " " + AID + "\n";
+    return sendTCPPacket(msg.c_str(), msg.length(), fd);
+}
+
+int RSBPacket::deserialize(const int fd) {
+    if (readString(fd, PACKET_ID_LEN) != std::string(ID) || readSpace(fd)) {
+        return 1;
+    }
+    status = readString(fd, MAX_STATUS_LEN);
+    return status.empty() || readNewLine(fd);
+}
+
+int EVTPacket::deserialize(const int fd) {
+    if (readString(fd, PACKET_ID_LEN) != std::string(ID) || readSpace(fd)) {
+        return 1;
+    }
+    std::string strKind = readString(fd, 1);
+    if (strKind.length() != 1 || readSpace(fd)) {
+        return 1;
+    }
+    kind = strKind.at(0);
+    std::string strAID = readString(fd, AID_LEN);
+    if (!isAID(strAID) || toInt(strAID, AID)) {
+        return 1;
+    }
+    if (kind == EVENT_OPENED || kind == EVENT_BID) {
+        if (readSpace(fd)) {
+            return 1;
+        }
+        UID = readString(fd, UID_LEN);
+        if (!isUID(UID) || readSpace(fd)) {
+            return 1;
+        }
+        if (toInt(readString(fd, MAX_VAL_DIGS), value, MAX_VAL_DIGS,
+                  MAX_VAL)) {
+            return 1;
+        }
+    } else if (kind != EVENT_CLOSED) {
+        return 1;
+    }
+    return readNewLine(fd);
+}
+
 std::string SRCPacket::serialize() {
     return std::string(ID) + " " + AID + "\n";
 }
@@ -396,93 +707,77 @@ int RRCPacket::deserialize(std::string &buffer) {
         return 1;
     }
     hostUID = readString(buffer);
-    if (checkUID(hostUID) || readSpace(buffer)) {
+    if (!isUID(hostUID) || readSpace(buffer)) {
         return 1;
     }
     auctionName = readString(buffer);
-    if (checkAuctionName(auctionName) || readSpace(buffer)) {
+    if (!isAuctionName(auctionName) || readSpace(buffer)) {
         return 1;
     }
     assetfName = readString(buffer);
-    if (checkFileName(assetfName) || readSpace(buffer)) {
+    if (!isFileName(assetfName) || readSpace(buffer)) {
         return 1;
     }
     std::string strStartValue = readString(buffer);
-    if (toInt(strStartValue, startValue) || startValue >= MAX_VAL ||
+    if (toInt(strStartValue, startValue, MAX_VAL_DIGS, MAX_VAL - 1) ||
         readSpace(buffer)) {
         return 1;
     }
     calStartDate = readString(buffer);
-    if (checkCalDate(calStartDate) || readSpace(buffer)) {
+    if (!isCalDate(calStartDate) || readSpace(buffer)) {
         return 1;
     }
     timeStartDate = readString(buffer);
-    if (checkTimeDate(timeStartDate) || readSpace(buffer)) {
+    if (!isTimeDate(timeStartDate) || readSpace(buffer)) {
         return 1;
     }
     std::string strTimeActive = readString(buffer);
-    if (toInt(strTimeActive, duration) || duration > MAX_DURATION) {
+    if (toInt(strTimeActive, duration, MAX_DURATION_DIGS, MAX_DURATION)) {
         return 1;
     }
+    return readRecord(buffer, bids, calEndDate, timeEndDate, endSecTime);
+}
 
-    if (!buffer.empty() && buffer.front() == '\n') {
+std::string SRDPacket::serialize() {
+    std::string msg = std::string(ID) + " " + AID + " ";
+    appendInt(msg, seq);
+    return msg + "\n";
+}
+
+int RRDPacket::deserialize(std::string &buffer) {
+    if (readString(buffer) != std::string(ID) || readSpace(buffer)) {
+        return 1;
+    }
+    status = readString(buffer);
+    if (status.empty()) {
+        return 1;
+    }
+    if (status != "OK") {
         return readNewLine(buffer);
     }
-    int i = 0;
-    do {
+    if (readSpace(buffer) ||
+        toInt(readString(buffer), seq, MAX_VAL_DIGS, MAX_VAL)) {
+        return 1;
+    }
+    return readRecord(buffer, bids, calEndDate, timeEndDate, endSecTime);
+}
+
+std::string STAPacket::serialize() { return std::string(ID) + "\n"; }
+
+int RSTPacket::deserialize(std::string &buffer) {
+    if (readString(buffer) != std::string(ID) || readSpace(buffer)) {
+        return 1;
+    }
+    status = readString(buffer);
+    if (status.empty()) {
+        return 1;
+    }
+    while (status == "OK" && !buffer.empty() && buffer.front() != '\n') {
         if (readSpace(buffer)) {
             return 1;
         }
-        std::string type = readString(buffer);
-        if (type == "B") {
-            if (readSpace(buffer)) {
-                return 1;
-            }
-            Bid bid;
-            bid.bidderUID = readString(buffer);
-            if (checkUID(bid.bidderUID) || readSpace(buffer)) {
-                return 1;
-            }
-            std::string strValue = readString(buffer);
-            if (toInt(strValue, bid.value) || bid.value > MAX_VAL ||
-                readSpace(buffer)) {
-                return 1;
-            }
-            bid.calDate = readString(buffer);
-            if (checkCalDate(bid.calDate) || readSpace(buffer)) {
-                return 1;
-            }
-            bid.timeDate = readString(buffer);
-            if (checkTimeDate(bid.timeDate) || readSpace(buffer)) {
-                return 1;
-            }
-            std::string strSecTime = readString(buffer);
-            if (toInt(strSecTime, bid.secTime) || bid.secTime > MAX_DURATION) {
-                return 1;
-            }
-            bids.push_back(bid);
-        } else if (type == "E") {
-            if (readSpace(buffer)) {
-                return 1;
-            }
-            calEndDate = readString(buffer);
-            if (checkCalDate(calEndDate) || readSpace(buffer)) {
-                return 1;
-            }
-            timeEndDate = readString(buffer);
-            if (checkTimeDate(timeEndDate) || readSpace(buffer)) {
-                return 1;
-            }
-            std::string strEndSecTime = readString(buffer);
-            if (toInt(strEndSecTime, endSecTime) || endSecTime > MAX_DURATION) {
-                return 1;
-            }
-            return readNewLine(buffer);
-        } else {
-            return 1;
-        }
-    } while (!buffer.empty() && buffer.front() != '\n' &&
-             ++i <= MAX_BIDS_LISTINGS);
+        metrics.push_back(readString(buffer));
+    }
     return readNewLine(buffer);
 }
 
@@ -494,11 +789,11 @@ std::string RLIPacket::serialize() {
 
 int LINPacket::deserialize(std::string &buffer) {
     UID = readString(buffer);
-    if (checkUID(UID) || readSpace(buffer)) {
+    if (!isUID(UID) || readSpace(buffer)) {
         return 1;
     }
     password = readString(buffer);
-    return checkPassword(password) || readNewLine(buffer);
+    return !isPassword(password) || readNewLine(buffer);
 }
 
 std::string RLOPacket::serialize() {
@@ -507,11 +802,11 @@ std::string RLOPacket::serialize() {
 
 int LOUPacket::deserialize(std::string &buffer) {
     UID = readString(buffer);
-    if (checkUID(UID) || readSpace(buffer)) {
+    if (!isUID(UID) || readSpace(buffer)) {
         return 1;
     }
     password = readString(buffer);
-    return checkPassword(password) || readNewLine(buffer);
+    return !isPassword(password) || readNewLine(buffer);
 }
 
 std::string RURPacket::serialize() {
@@ -520,11 +815,11 @@ std::string RURPacket::serialize() {
 
 int UNRPacket::deserialize(std::string &buffer) {
     UID = readString(buffer);
-    if (checkUID(UID) || readSpace(buffer)) {
+    if (!isUID(UID) || readSpace(buffer)) {
         return 1;
     }
     password = readString(buffer);
-    return checkPassword(password) || readNewLine(buffer);
+    return !isPassword(password) || readNewLine(buffer);
 }
 
 int ROAPacket::serialize(const int fd) {
@@ -538,39 +833,145 @@ int ROAPacket::serialize(const int fd) {
 
 int OPAPacket::deserialize(const int fd) {
     UID = readString(fd, UID_LEN);
-    if (checkUID(UID) || readSpace(fd)) {
+    if (!isUID(UID) || readSpace(fd)) {
         return 1;
     }
     password = readString(fd, PASSWORD_LEN);
-    if (checkPassword(password) || readSpace(fd)) {
+    if (!isPassword(password) || readSpace(fd)) {
         return 1;
     }
     auctionName = readString(fd, MAX_AUCTION_NAME_LEN);
-    if (checkAuctionName(auctionName) || readSpace(fd)) {
+    if (!isAuctionName(auctionName) || readSpace(fd)) {
         return 1;
     }
     std::string strStartValue = readString(fd, MAX_VAL_DIGS);
-    if (toInt(strStartValue, startValue) || startValue >= MAX_VAL ||
+    if (toInt(strStartValue, startValue, MAX_VAL_DIGS, MAX_VAL - 1) ||
         readSpace(fd)) {
         return 1;
     }
     std::string strTimeActive = readString(fd, MAX_DURATION_DIGS);
-    if (toInt(strTimeActive, duration) || duration > MAX_DURATION ||
+    if (toInt(strTimeActive, duration, MAX_DURATION_DIGS, MAX_DURATION) ||
         readSpace(fd)) {
         return 1;
     }
     assetfName = readString(fd, MAX_FILE_NAME_LEN);
-    if (checkFileName(assetfName) || readSpace(fd)) {
+    if (!isFileName(assetfName) || readSpace(fd)) {
         return 1;
     }
     std::string strfSize = readString(fd, MAX_FILE_SIZE_DIGS);
-    if (toInt(strfSize, assetfSize) || assetfSize == 0 ||
-        assetfSize > MAX_FILE_SIZE || readSpace(fd)) {
+    if (toInt(strfSize, assetfSize, MAX_FILE_SIZE_DIGS, MAX_FILE_SIZE) ||
+        assetfSize == 0 || readSpace(fd)) {
         return 1;
     }
     return receiveFile(assetfName, assetfSize, fd) || readNewLine(fd);
 }
 
+int RUSPacket::serialize(const int fd) {
+    std::string msg = std::string(ID) + " " + status;
+    if (status == "OK") {
+        msg += " " + toDigits(token, UPLOAD_TOKEN_LEN);
+    }
+    msg += "\n";
+    return sendTCPPacket(msg.c_str(), msg.length(), fd);
+}
+
+int UPSPacket::deserialize(const int fd) {
+    UID = readString(fd, UID_LEN);
+    if (!isUID(UID) || readSpace(fd)) {
+        return 1;
+    }
+    password = readString(fd, PASSWORD_LEN);
+    if (!isPassword(password) || readSpace(fd)) {
+        return 1;
+    }
+    if (toInt(readString(fd, MAX_FILE_SIZE_DIGS), assetfSize,
+              MAX_FILE_SIZE_DIGS, MAX_FILE_SIZE) ||
+        assetfSize == 0) {
+        return 1;
+    }
+    return readNewLine(fd);
+}
+
+int RUCPacket::serialize(const int fd) {
+    std::string msg = std::string(ID) + " " + status + "\n";
+    return sendTCPPacket(msg.c_str(), msg.length(), fd);
+}
+
+int UPCPacket::deserialize(const int fd) {
+    if (toInt(readString(fd, UPLOAD_TOKEN_LEN), token, UPLOAD_TOKEN_LEN) ||
+        readSpace(fd)) {
+        return 1;
+    }
+    if (toInt(readString(fd, MAX_FILE_SIZE_DIGS), offset, MAX_FILE_SIZE_DIGS,
+              MAX_FILE_SIZE) ||
+        readSpace(fd)) {
+        return 1;
+    }
+    if (toInt(readString(fd, MAX_FILE_SIZE_DIGS), length, MAX_FILE_SIZE_DIGS,
+              UPLOAD_CHUNK_SIZE) ||
+        length == 0 || readSpace(fd)) {
+        return 1;
+    }
+    return fromHex(readString(fd, CRC_LEN), crc) || readSpace(fd);
+}
+
+int UPCPacket::receiveData(const int fd, const int fileFD, uint32_t &done,
+                           uint32_t &received) {
+    std::vector<char> buffer(fileBufferSize);
+    while (done < length) {
+        ssize_t n = recv(fd, buffer.data(),
+                         std::min<size_t>(length - done, fileBufferSize),
+                         MSG_DONTWAIT);
+        if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return 0; // the rest has not arrived yet
+        }
+        if (n <= 0) {
+            return 1;
+        }
+        received = crc32(buffer.data(), (size_t)n, received);
+        if (fileFD != -1 && pwrite(fileFD, buffer.data(), (size_t)n,
+                                   (off_t)(offset + done)) != n) {
+            std::cerr << FILE_ERR << std::endl;
+            return 1;
+        }
+        done += (uint32_t)n;
+    }
+    return readNewLine(fd);
+}
+
+int OPCPacket::deserialize(const int fd) {
+    UID = readString(fd, UID_LEN);
+    if (!isUID(UID) || readSpace(fd)) {
+        return 1;
+    }
+    password = readString(fd, PASSWORD_LEN);
+    if (!isPassword(password) || readSpace(fd)) {
+        return 1;
+    }
+    auctionName = readString(fd, MAX_AUCTION_NAME_LEN);
+    if (!isAuctionName(auctionName) || readSpace(fd)) {
+        return 1;
+    }
+    if (toInt(readString(fd, MAX_VAL_DIGS), startValue, MAX_VAL_DIGS,
+              MAX_VAL - 1) ||
+        readSpace(fd)) {
+        return 1;
+    }
+    if (toInt(readString(fd, MAX_DURATION_DIGS), duration, MAX_DURATION_DIGS,
+              MAX_DURATION) ||
+        readSpace(fd)) {
+        return 1;
+    }
+    assetfName = readString(fd, MAX_FILE_NAME_LEN);
+    if (!isFileName(assetfName) || readSpace(fd)) {
+        return 1;
+    }
+    if (toInt(readString(fd, UPLOAD_TOKEN_LEN), token, UPLOAD_TOKEN_LEN)) {
+        return 1;
+    }
+    return readNewLine(fd);
+}
+
 int RCLPacket::serialize(const int fd) {
     std::string msg = std::string(ID) + " " + status + "\n";
     return sendTCPPacket(msg.c_str(), msg.length(), fd);
@@ -578,53 +979,120 @@ int RCLPacket::serialize(const int fd) {
 
 int CLSPacket::deserialize(const int fd) {
     UID = readString(fd, UID_LEN);
-    if (checkUID(UID) || readSpace(fd)) {
+    if (!isUID(UID) || readSpace(fd)) {
         return 1;
     }
     password = readString(fd, PASSWORD_LEN);
-    if (checkPassword(password) || readSpace(fd)) {
+    if (!isPassword(password) || readSpace(fd)) {
         return 1;
     }
     AID = readString(fd, AID_LEN);
-    return checkAID(AID) || readNewLine(fd);
+    return !isAID(AID) || readNewLine(fd);
 }
 
 std::string RMAPacket::serialize() {
     std::string msg = std::string(ID) + " " + status;
     for (const Auction &auction : auctions) {
-        msg += " " + auction.AID + " " + std::to_string(auction.state);
+        msg += " " + toDigits(auction.AID, AID_LEN) + " ";
+        msg += (char)('0' + auction.state);
     }
     return msg + "\n";
 }
 
 int LMAPacket::deserialize(std::string &buffer) {
     UID = readString(buffer);
-    return checkUID(UID) || readNewLine(buffer);
+    return !isUID(UID) || readNewLine(buffer);
 }
 
 std::string RMBPacket::serialize() {
     std::string msg = std::string(ID) + " " + status;
     for (const Auction &auction : auctions) {
-        msg += " " + auction.AID + " " + std::to_string(auction.state);
+        msg += " " + toDigits(auction.AID, AID_LEN) + " ";
+        msg += (char)('0' + auction.state);
     }
     return msg + "\n";
 }
 
 int LMBPacket::deserialize(std::string &buffer) {
     UID = readString(buffer);
-    return checkUID(UID) || readNewLine(buffer);
+    return !isUID(UID) || readNewLine(buffer);
 }
 
 std::string RLSPacket::serialize() {
     std::string msg = std::string(ID) + " " + status;
     for (const Auction &auction : auctions) {
-        msg += " " + auction.AID + " " + std::to_string(auction.state);
+        msg += " " + toDigits(auction.AID, AID_LEN) + " ";
+        msg += (char)('0' + auction.state);
     }
     return msg + "\n";
 }
 
 int LSTPacket::deserialize(std::string &buffer) { return !buffer.empty(); }
 
+std::string RLPPacket::serialize() {
+    std::string msg = std::string(ID) + " " + status;
+    if (status == "OK") {
+        msg += " " + toDigits(next, AID_LEN);
+    }
+    for (const Auction &auction : auctions) {
+        msg += " " + toDigits(auction.AID, AID_LEN) + " ";
+        msg += (char)('0' + auction.state);
+    }
+    return msg + "\n";
+}
+
+int LPGPacket::deserialize(std::string &buffer) {
+    std::string strCursor = readString(buffer);
+    if (!isAID(strCursor) || toInt(strCursor, cursor) || readSpace(buffer) ||
+        toInt(readString(buffer), pageSize, MAX_PAGE_SIZE_DIGS,
+              MAX_PAGE_SIZE) ||
+        pageSize == 0 || readSpace(buffer)) {
+        return 1;
+    }
+    uint32_t active;
+    if (toInt(readString(buffer), active, 1, 1)) {
+        return 1;
+    }
+    activeOnly = (uint8_t)active;
+    return readNewLine(buffer);
+}
+
+std::string RLFPacket::serialize() {
+    std::string msg = std::string(ID) + " " + status;
+    for (const Auction &auction : auctions) {
+        msg += " " + toDigits(auction.AID, AID_LEN) + " ";
+        msg += (char)('0' + auction.state);
+    }
+    return msg + "\n";
+}
+
+int LFLPacket::deserialize(std::string &buffer) {
+    std::string strFilter = readString(buffer);
+    if (strFilter.length() != 1) {
+        return 1;
+    }
+    filter = strFilter.at(0);
+    if (filter == FILTER_RANGE) {
+        std::string strFrom, strTo;
+        if (readSpace(buffer) || !isAID(strFrom = readString(buffer)) ||
+            toInt(strFrom, from) || readSpace(buffer) ||
+            !isAID(strTo = readString(buffer)) || toInt(strTo, to) ||
+            from == 0 || from > to) {
+            return 1;
+        }
+    } else if (filter == FILTER_ENDING) {
+        if (readSpace(buffer) ||
+            toInt(readString(buffer), within, MAX_DURATION_DIGS,
+                  MAX_DURATION) ||
+            within == 0) {
+            return 1;
+        }
+    } else if (filter != FILTER_ACTIVE) {
+        return 1;
+    }
+    return readNewLine(buffer);
+}
+
 int RBDPacket::serialize(const int fd) {
     std::string msg = std::string(ID) + " " + status + "\n";
     return sendTCPPacket(msg.c_str(), msg.length(), fd);
@@ -632,19 +1100,19 @@ int RBDPacket::serialize(const int fd) {
 
 int BIDPacket::deserialize(const int fd) {
     UID = readString(fd, UID_LEN);
-    if (checkUID(UID) || readSpace(fd)) {
+    if (!isUID(UID) || readSpace(fd)) {
         return 1;
     }
     password = readString(fd, PASSWORD_LEN);
-    if (checkPassword(password) || readSpace(fd)) {
+    if (!isPassword(password) || readSpace(fd)) {
         return 1;
     }
     AID = readString(fd, AID_LEN);
-    if (checkAID(AID) || readSpace(fd)) {
+    if (!isAID(AID) || readSpace(fd)) {
         return 1;
     }
     std::string strValue = readString(fd, MAX_VAL_DIGS);
-    if (toInt(strValue, value) || value > MAX_VAL) {
+    if (toInt(strValue, value, MAX_VAL_DIGS, MAX_VAL)) {
         return 1;
     }
     return readNewLine(fd);
@@ -658,7 +1126,81 @@ int RSAPacket::serialize(const int fd) {
 
 int SASPacket::deserialize(const int fd) {
     AID = readString(fd, AID_LEN);
-    return checkAID(AID) || readNewLine(fd);
+    return !isAID(AID) || readNewLine(fd);
+}
+
+int RSRPacket::serialize(const int fd) {
+    std::string msg = std::string(ID) + " " + status;
+    if (status != "OK") {
+        msg += "\n";
+        return sendTCPPacket(msg.c_str(), msg.length(), fd);
+    }
+    int file = open(assetfPath.c_str(), O_RDONLY);
+    struct stat st;
+    if (file == -1 || fstat(file, &st) == -1 || st.st_size == 0 ||
+        st.st_size > MAX_FILE_SIZE) {
+        if (file != -1) {
+            close(file);
+        }
+        std::cerr << FILE_ERR << std::endl;
+        return 1;
+    }
+    assetfSize = (uint32_t)st.st_size;
+    offset = std::min(offset, assetfSize);
+    if (length == 0 || length > assetfSize - offset) {
+        length = assetfSize - offset;
+    }
+    msg += " " + std::filesystem::path(assetfPath).filename().string() + " ";
+    appendInt(msg, assetfSize);
+    msg += " ";
+    appendInt(msg, offset);
+    msg += " ";
+    appendInt(msg, length);
+    msg += " ";
+    char newLine = '\n';
+    int res = sendTCPPacket(msg.c_str(), msg.length(), fd) ||
+              sendFileRange(file, offset, length, fd) ||
+              sendTCPPacket(&newLine, 1, fd);
+    close(file);
+    return res;
+}
+
+int SARPacket::deserialize(const int fd) {
+    AID = readString(fd, AID_LEN);
+    if (!isAID(AID) || readSpace(fd)) {
+        return 1;
+    }
+    if (toInt(readString(fd, MAX_FILE_SIZE_DIGS), offset, MAX_FILE_SIZE_DIGS,
+              MAX_FILE_SIZE) ||
+        readSpace(fd)) {
+        return 1;
+    }
+    if (toInt(readString(fd, MAX_FILE_SIZE_DIGS), length, MAX_FILE_SIZE_DIGS,
+              MAX_FILE_SIZE)) {
+        return 1;
+    }
+    return readNewLine(fd);
+}
+
+int RSBPacket::serialize(const int fd) {
+    std::string msg = std::string(ID) + " " + status + "\n";
+    return sendTCPPacket(msg.c_str(), msg.length(), fd);
+}
+
+int SUBPacket::deserialize(const int fd) {
+    AID = readString(fd, AID_LEN);
+    return !isAID(AID) || readNewLine(fd);
+}
+
+int EVTPacket::serialize(const int fd) {
+    std::string msg =
+        std::string(ID) + " " + kind + " " + toDigits(AID, AID_LEN);
+    if (kind != EVENT_CLOSED) {
+        msg += " " + UID + " ";
+        appendInt(msg, value);
+    }
+    msg += "\n";
+    return sendTCPPacket(msg.c_str(), msg.length(), fd);
 }
 
 std::string RRCPacket::serialize() {
@@ -671,9 +1213,38 @@ std::string RRCPacket::serialize() {
 
 int SRCPacket::deserialize(std::string &buffer) {
     AID = readString(buffer);
-    return checkAID(AID) || readNewLine(buffer);
+    return !isAID(AID) || readNewLine(buffer);
+}
+
+std::string RRDPacket::serialize() {
+    std::string msg = std::string(ID) + " " + status;
+    if (status == "OK") {
+        msg += " " + info;
+    }
+    return msg + "\n";
+}
+
+int SRDPacket::deserialize(std::string &buffer) {
+    AID = readString(buffer);
+    if (!isAID(AID) || readSpace(buffer)) {
+        return 1;
+    }
+    if (toInt(readString(buffer), seq, MAX_VAL_DIGS, MAX_VAL)) {
+        return 1;
+    }
+    return readNewLine(buffer);
 }
 
+std::string RSTPacket::serialize() {
+    std::string msg = std::string(ID) + " " + status;
+    if (status == "OK") {
+        msg += " " + info;
+    }
+    return msg + "\n";
+}
+
+int STAPacket::deserialize(std::string &buffer) { return !buffer.empty(); }
+
 std::string ERRUDPPacket::serialize() { return std::string(ID) + "\n"; }
 
 int ERRTCPPacket::serialize(const int fd) {
@@ -689,7 +1260,11 @@ int ERRTCPPacket::serialize(const int fd) {
 
 int sendUDPPacket(UDPPacket &packet, struct sockaddr *addr, socklen_t addrlen,
                   const int fd) {
-    std::string msg = packet.serialize();
+    return sendUDPMessage(packet.serialize(), addr, addrlen, fd);
+}
+
+int sendUDPMessage(const std::string &msg, struct sockaddr *addr,
+                   socklen_t addrlen, const int fd) {
     if (sendto(fd, msg.c_str(), msg.length(), 0, addr, addrlen) == -1) {
         std::cerr << SENDTO_ERR << std::endl;
         return 1;
@@ -699,20 +1274,20 @@ int sendUDPPacket(UDPPacket &packet, struct sockaddr *addr, socklen_t addrlen,
 
 int receiveUDPPacket(std::string &response, struct sockaddr *addr,
                      socklen_t *addrlen, const int fd, const size_t lim) {
-    char msg[lim + 1] = {0};
+    response.assign(lim, '\0');
     ssize_t n;
-    if ((n = recvfrom(fd, msg, lim, 0, addr, addrlen)) == -1) {
+    if ((n = recvfrom(fd, &response[0], lim, 0, addr, addrlen)) == -1) {
         if (errno == EINTR || errno == EAGAIN) {
             return 1;
         }
         std::cerr << RECVFROM_ERR << std::endl;
         return 1;
     }
-    if (n == lim) {
+    if ((size_t)n == lim) {
         std::cerr << PACKET_ERR << std::endl;
         return 1;
     }
-    response = msg;
+    response.resize((size_t)n);
     return 0;
 }
 
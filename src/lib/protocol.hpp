@@ -1,11 +1,18 @@
 #ifndef __PROTOCOL_HPP__
 #define __PROTOCOL_HPP__
 
+#include "constants.hpp"
 #include "utils.hpp"
 
 #include <string>
+#include <sys/types.h>
 #include <vector>
 
+// Filters of the list filter packet (LFL)
+constexpr char FILTER_ACTIVE = 'A';
+constexpr char FILTER_RANGE = 'R';
+constexpr char FILTER_ENDING = 'E';
+
 class UDPPacket {
   public:
     virtual std::string serialize() = 0;
@@ -17,6 +24,10 @@ class UDPPacket {
     int readSpace(std::string &buffer);
     int readNewLine(std::string &buffer);
     int readAuctions(std::string &buffer, std::vector<Auction> &auctions);
+    // The bids and end of an auction record, up to the end of the line
+    int readRecord(std::string &buffer, std::vector<Bid> &bids,
+                   std::string &calEndDate, std::string &timeEndDate,
+                   uint32_t &endSecTime);
 };
 
 class TCPPacket {
@@ -25,12 +36,20 @@ class TCPPacket {
     virtual int deserialize(const int fd) = 0;
     virtual ~TCPPacket() = default;
 
+    // size of the chunks files are sent and received in
+    static inline size_t fileBufferSize = FILE_BUFFER_SIZE;
+
   protected:
     std::string readString(const int fd, const size_t lim);
     int readSpace(const int fd);
     int readNewLine(const int fd);
     int sendFile(std::string fPath, const int fd);
-    int receiveFile(std::string fName, size_t fSize, const int fd);
+    // Sends length bytes of the file from offset on, with sendfile()
+    int sendFileRange(const int fileFD, off_t offset, size_t length,
+                      const int fd);
+    // With an offset the file is cut to that size and the bytes appended
+    int receiveFile(std::string fName, size_t fSize, const int fd,
+                    size_t offset = 0);
 
   private:
     char delim = 0;
@@ -134,6 +153,79 @@ class ROAPacket : public TCPPacket {
     int deserialize(const int fd);
 };
 
+// Send upload start packet (UPS), for an asset that is sent in chunks with UPC,
+// over many connections, and then opened as an auction with OPC
+class UPSPacket : public TCPPacket {
+  public:
+    static constexpr const char *ID = "UPS";
+    std::string UID;
+    std::string password;
+    uint32_t assetfSize;
+
+    int serialize(const int fd);
+    int deserialize(const int fd);
+};
+
+// Receive upload start packet (RUS), with the token of the upload
+class RUSPacket : public TCPPacket {
+  public:
+    static constexpr const char *ID = "RUS";
+    std::string status;
+    uint32_t token;
+
+    int serialize(const int fd);
+    int deserialize(const int fd);
+};
+
+// Send upload chunk packet (UPC), length bytes of the asset from offset on and
+// their CRC-32. On the server deserialize only reads up to the data.
+class UPCPacket : public TCPPacket {
+  public:
+    static constexpr const char *ID = "UPC";
+    uint32_t token;
+    uint32_t offset;
+    uint32_t length;
+    uint32_t crc;
+
+    std::string data; // sent by the user
+
+    int serialize(const int fd);
+    int deserialize(const int fd);
+    // Reads the data that already arrived, from done on, and writes it to the
+    // file at its offset, adding it to the CRC-32 in received. Once done gets
+    // to the length the newline after the data is read as well. With a fileFD
+    // of -1 the data is only read, so that the reply is not lost to a reset.
+    int receiveData(const int fd, const int fileFD, uint32_t &done,
+                    uint32_t &received);
+};
+
+// Receive upload chunk packet (RUC), CRC if the data arrived corrupted
+class RUCPacket : public TCPPacket {
+  public:
+    static constexpr const char *ID = "RUC";
+    std::string status;
+
+    int serialize(const int fd);
+    int deserialize(const int fd);
+};
+
+// Send open upload packet (OPC), opens an auction with the asset of a finished
+// upload, answered with ROA
+class OPCPacket : public TCPPacket {
+  public:
+    static constexpr const char *ID = "OPC";
+    std::string UID;
+    std::string password;
+    std::string auctionName;
+    uint32_t startValue;
+    uint32_t duration;
+    std::string assetfName;
+    uint32_t token;
+
+    int serialize(const int fd);
+    int deserialize(const int fd);
+};
+
 // Send close packet (CLS)
 class CLSPacket : public TCPPacket {
   public:
@@ -142,6 +234,7 @@ class CLSPacket : public TCPPacket {
     std::string password;
     std::string AID;
 
+    std::string message(); // the request serialize sends
     int serialize(const int fd);
     int deserialize(const int fd);
 };
@@ -224,6 +317,64 @@ class RLSPacket : public UDPPacket {
     int deserialize(std::string &buffer);
 };
 
+// Send list page packet (LPG), lists at most pageSize auctions with an AID
+// over the cursor, only the active ones if asked
+#define LPG_LEN (PACKET_ID_LEN + AID_LEN + MAX_PAGE_SIZE_DIGS + 5)
+class LPGPacket : public UDPPacket {
+  public:
+    static constexpr const char *ID = "LPG";
+    uint32_t cursor = 0; // 0 for the first page
+    uint32_t pageSize = MAX_PAGE_SIZE;
+    uint8_t activeOnly = 0;
+
+    std::string serialize();
+    int deserialize(std::string &buffer);
+};
+
+// Receive list page packet (RLP), next is the cursor of the following page
+// or 0 if it was the last one
+#define RLP_LEN                                                                \
+    (PACKET_ID_LEN + AID_LEN + 6 + MAX_PAGE_SIZE * (AID_LEN + 3) + 1)
+class RLPPacket : public UDPPacket {
+  public:
+    static constexpr const char *ID = "RLP";
+    std::string status;
+    uint32_t next = 0;
+    std::vector<Auction> auctions;
+
+    std::string serialize();
+    int deserialize(std::string &buffer);
+};
+
+// Send list filter packet (LFL), lists the active auctions (A), the ones with
+// an AID from one number to another (R), or the active ones that end within
+// some seconds (E)
+#define LFL_LEN (PACKET_ID_LEN + 2 * AID_LEN + 5)
+class LFLPacket : public UDPPacket {
+  public:
+    static constexpr const char *ID = "LFL";
+    char filter = FILTER_ACTIVE;
+    uint32_t from = 1; // AIDs, for a range
+    uint32_t to = MAX_AUCTIONS;
+    uint32_t within = 0; // seconds, for the ones ending
+
+    std::string serialize();
+    int deserialize(std::string &buffer);
+};
+
+// Receive list filter packet (RLF), the auctions ending within some seconds
+// come in the order they end, the others by AID
+#define RLF_LEN RLS_LEN
+class RLFPacket : public UDPPacket {
+  public:
+    static constexpr const char *ID = "RLF";
+    std::string status;
+    std::vector<Auction> auctions;
+
+    std::string serialize();
+    int deserialize(std::string &buffer);
+};
+
 // Send bid packet (BID)
 class BIDPacket : public TCPPacket {
   public:
@@ -233,6 +384,7 @@ class BIDPacket : public TCPPacket {
     std::string AID;
     uint32_t value;
 
+    std::string message(); // the request serialize sends
     int serialize(const int fd);
     int deserialize(const int fd);
 };
@@ -271,6 +423,78 @@ class RSAPacket : public TCPPacket {
     int deserialize(const int fd);
 };
 
+// Send showAsset range packet (SAR), for length bytes of the asset from offset
+// on, or the rest of it if length is 0
+class SARPacket : public TCPPacket {
+  public:
+    static constexpr const char *ID = "SAR";
+    std::string AID;
+    uint32_t offset;
+    uint32_t length;
+
+    int serialize(const int fd);
+    int deserialize(const int fd);
+};
+
+// Receive showAsset range packet (RSR), with the size of the whole asset and
+// the range that was sent, cut at the end of the file
+class RSRPacket : public TCPPacket {
+  public:
+    static constexpr const char *ID = "RSR";
+    std::string status;
+    std::string assetfName;
+    uint32_t assetfSize;
+    uint32_t offset;
+    uint32_t length;
+
+    std::string assetfPath; // sent by the server
+    std::string partPath;   // the range is written to, by the user
+
+    int serialize(const int fd);
+    int deserialize(const int fd);
+};
+
+// Send subscribe packet (SUB), for the events of an auction or, with the AID
+// 000, of every auction. The connection stays open after the reply.
+class SUBPacket : public TCPPacket {
+  public:
+    static constexpr const char *ID = "SUB";
+    std::string AID;
+
+    int serialize(const int fd);
+    int deserialize(const int fd);
+};
+
+// Receive subscribe packet (RSB)
+class RSBPacket : public TCPPacket {
+  public:
+    static constexpr const char *ID = "RSB";
+    std::string status;
+
+    int serialize(const int fd);
+    int deserialize(const int fd);
+};
+
+// Kinds of events pushed to the subscribers
+constexpr char EVENT_OPENED = 'O';
+constexpr char EVENT_BID = 'B';
+constexpr char EVENT_CLOSED = 'C';
+
+// Event packet (EVT), sent by the server to the subscribers. An opened
+// auction comes with its host and start value, a new highest bid with the
+// bidder and its value, a closed auction with neither.
+class EVTPacket : public TCPPacket {
+  public:
+    static constexpr const char *ID = "EVT";
+    char kind;
+    uint32_t AID;
+    std::string UID;
+    uint32_t value = 0;
+
+    int serialize(const int fd);
+    int deserialize(const int fd);
+};
+
 // Send showRecord packet (SRC)
 #define SRC_LEN 9
 class SRCPacket : public UDPPacket {
@@ -306,6 +530,63 @@ class RRCPacket : public UDPPacket {
     int deserialize(std::string &buffer);
 };
 
+// Send showRecord delta packet (SRD), seq is the number of bids of the auction
+// the user has already seen
+#define SRD_LEN (PACKET_ID_LEN + AID_LEN + MAX_VAL_DIGS + 3)
+class SRDPacket : public UDPPacket {
+  public:
+    static constexpr const char *ID = "SRD";
+    std::string AID;
+    uint32_t seq = 0;
+
+    std::string serialize();
+    int deserialize(std::string &buffer);
+};
+
+// Receive showRecord delta packet (RRD), with the bids after the ones already
+// seen (at most the last 50) and the end, if the auction ended. UNC if there
+// were no new bids and it's still active.
+#define RRD_LEN RRC_LEN
+class RRDPacket : public UDPPacket {
+  public:
+    static constexpr const char *ID = "RRD";
+    std::string status;
+    uint32_t seq = 0; // bids so far
+    std::vector<Bid> bids;
+    std::string calEndDate;
+    std::string timeEndDate;
+    uint32_t endSecTime;
+
+    std::string info;
+
+    std::string serialize();
+    int deserialize(std::string &buffer);
+};
+
+// Send stats packet (STA)
+#define STA_LEN 5
+class STAPacket : public UDPPacket {
+  public:
+    static constexpr const char *ID = "STA";
+
+    std::string serialize();
+    int deserialize(std::string &buffer);
+};
+
+// Receive stats packet (RST)
+#define RST_LEN 65507
+class RSTPacket : public UDPPacket {
+  public:
+    static constexpr const char *ID = "RST";
+    std::string status;
+    std::vector<std::string> metrics;
+
+    std::string info;
+
+    std::string serialize();
+    int deserialize(std::string &buffer);
+};
+
 // Error UDP packet (ERR)
 class ERRUDPPacket : public UDPPacket {
   public:
@@ -331,6 +612,9 @@ class ERRTCPPacket : public TCPPacket {
 int sendUDPPacket(UDPPacket &packet, struct sockaddr *addr, socklen_t addrlen,
                   const int fd);
 
+int sendUDPMessage(const std::string &msg, struct sockaddr *addr,
+                   socklen_t addrlen, const int fd);
+
 int receiveUDPPacket(std::string &response, struct sockaddr *addr,
                      socklen_t *addrlen, const int fd, const size_t lim);
 
@@ -1,38 +1,143 @@
 #include "utils.hpp"
 #include "messages.hpp"
 
-#include <cctype>
+#include <algorithm>
+#include <array>
+#include <charconv>
 #include <csignal>
 #include <cstdint>
 #include <cstring>
 #include <filesystem>
 #include <iostream>
-#include <sstream>
 
-int toInt(std::string intStr, uint32_t &num) {
-    try {
-        size_t conv = 0;
-        int64_t resNum = std::stoll(intStr, &conv, 10);
-        if (conv != intStr.length() || resNum < 0 || resNum > INT32_MAX) {
-            return 1;
-        }
-        num = (uint32_t)resNum;
-    } catch (...) {
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+int toInt(std::string_view intStr, uint32_t &num, size_t maxDigits,
+          uint32_t maxNum) {
+    // from_chars takes no signs or spaces, unlike stoll
+    if (intStr.empty() || intStr.length() > maxDigits) {
         return 1;
     }
+    const char *end = intStr.data() + intStr.length();
+    uint32_t res;
+    auto [ptr, ec] = std::from_chars(intStr.data(), end, res);
+    if (ec != std::errc() || ptr != end || res > maxNum) {
+        return 1;
+    }
+    num = res;
     return 0;
 }
 
+void appendInt(std::string &str, uint64_t num) {
+    char digits[20];
+    auto res = std::to_chars(digits, digits + sizeof(digits), num);
+    str.append(digits, (size_t)(res.ptr - digits));
+}
+
+// Table k holds the CRC of a byte followed by k zero bytes, so that eight
+// bytes are folded in at a time
+static constexpr std::array<std::array<uint32_t, 256>, 8> makeCRCTables() {
+    std::array<std::array<uint32_t, 256>, 8> tables{};
+    for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; ++k) {
+            c = (c & 1) ? 0xEDB88320U ^ (c >> 1) : c >> 1;
+        }
+        tables[0][i] = c;
+    }
+    for (size_t k = 1; k < 8; ++k) {
+        for (size_t i = 0; i < 256; ++i) {
+            uint32_t c = tables[k - 1][i];
+            tables[k][i] = tables[0][c & 0xFF] ^ (c >> 8);
+        }
+    }
+    return tables;
+}
+
+static constexpr std::array<std::array<uint32_t, 256>, 8> CRC_TABLES =
+    makeCRCTables();
+
+uint32_t crc32(const char *data, size_t len, uint32_t crc) {
+    const auto &t = CRC_TABLES;
+    crc = ~crc;
+    for (; len >= 8; data += 8, len -= 8) {
+        uint32_t lo, hi; // little endian, like the SSE2 code of this file
+        memcpy(&lo, data, 4);
+        memcpy(&hi, data + 4, 4);
+        lo ^= crc;
+        crc = t[7][lo & 0xFF] ^ t[6][(lo >> 8) & 0xFF] ^
+              t[5][(lo >> 16) & 0xFF] ^ t[4][lo >> 24] ^ t[3][hi & 0xFF] ^
+              t[2][(hi >> 8) & 0xFF] ^ t[1][(hi >> 16) & 0xFF] ^ t[0][hi >> 24];
+    }
+    for (; len > 0; ++data, --len) {
+        crc = t[0][(crc ^ (uint8_t)*data) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+static inline void writeDigits(char *dst, uint32_t num, size_t width) {
+    while (width-- > 0) {
+        dst[width] = (char)('0' + num % 10);
+        num /= 10;
+    }
+}
+
+std::string toDigits(uint32_t num, size_t width) {
+    std::string digits(width, '0');
+    writeDigits(&digits[0], num, width);
+    return digits;
+}
+
+void formatDate(time_t seconds, char *date) {
+    // The calendar part only changes once a day, so it is cached per thread
+    static thread_local time_t cachedDay = -1;
+    static thread_local char cachedCalDate[CAL_DATE_LEN + 1];
+
+    time_t day = seconds / SECS_PER_DAY;
+    time_t secsOfDay = seconds % SECS_PER_DAY;
+    if (secsOfDay < 0) { // dates before the epoch
+        --day;
+        secsOfDay += SECS_PER_DAY;
+    }
+    if (day != cachedDay) {
+        struct tm t;
+        gmtime_r(&seconds, &t);
+        writeDigits(cachedCalDate, (uint32_t)(t.tm_year + 1900), 4);
+        cachedCalDate[4] = '-';
+        writeDigits(cachedCalDate + 5, (uint32_t)(t.tm_mon + 1), 2);
+        cachedCalDate[7] = '-';
+        writeDigits(cachedCalDate + 8, (uint32_t)t.tm_mday, 2);
+        cachedCalDate[CAL_DATE_LEN] = ' ';
+        cachedDay = day;
+    }
+
+    uint32_t secs = (uint32_t)secsOfDay;
+    memcpy(date, cachedCalDate, CAL_DATE_LEN + 1);
+    char *time = date + CAL_DATE_LEN + 1;
+    writeDigits(time, secs / 3600, 2);
+    time[2] = ':';
+    writeDigits(time + 3, secs / 60 % 60, 2);
+    time[5] = ':';
+    writeDigits(time + 6, secs % 60, 2);
+}
+
 std::string toDate(time_t seconds) {
-    struct tm *time = gmtime(&seconds);
-    std::stringstream date;
-    date << time->tm_year + 1900 << "-" << std::setfill('0') << std::setw(2)
-         << time->tm_mon + 1 << "-" << std::setfill('0') << std::setw(2)
-         << time->tm_mday << " " << std::setfill('0') << std::setw(2)
-         << time->tm_hour << ":" << std::setfill('0') << std::setw(2)
-         << time->tm_min << ":" << std::setfill('0') << std::setw(2)
-         << time->tm_sec;
-    return date.str();
+    char date[DATE_LEN];
+    formatDate(seconds, date);
+    return std::string(date, DATE_LEN);
+}
+
+int parseDate(std::string date, time_t &seconds) {
+    struct tm tm;
+    memset(&tm, 0, sizeof(tm));
+    const char *end = strptime(date.c_str(), "%Y-%m-%d %H:%M:%S", &tm);
+    if (end == NULL || *end != '\0') {
+        return 1;
+    }
+    seconds = timegm(&tm);
+    return 0;
 }
 
 int checkPort(std::string port) {
@@ -53,59 +158,229 @@ int checkPort(std::string port) {
     return 0;
 }
 
-int checkUID(std::string uid) {
-    if (uid.length() != UID_LEN) {
-        std::cerr << UID_ERR << std::endl;
-        return 1;
+// Classes of the characters allowed in the fields of the packets
+constexpr uint8_t CHAR_DIGIT = 1;
+constexpr uint8_t CHAR_ALPHA = 2;
+constexpr uint8_t CHAR_NAME = 4; // '-' and '_'
+constexpr uint8_t CHAR_DOT = 8;
+constexpr uint8_t CHAR_ALNUM = CHAR_DIGIT | CHAR_ALPHA;
+
+static constexpr std::array<uint8_t, 256> makeCharClasses() {
+    std::array<uint8_t, 256> classes{};
+    for (int c = '0'; c <= '9'; ++c) {
+        classes[(size_t)c] = CHAR_DIGIT;
+    }
+    for (int c = 'a'; c <= 'z'; ++c) {
+        classes[(size_t)c] = classes[(size_t)(c - 'a' + 'A')] = CHAR_ALPHA;
     }
-    for (char c : uid) {
-        if (!isdigit(c)) {
-            std::cerr << UID_ERR << std::endl;
-            return 1;
+    classes['-'] = classes['_'] = CHAR_NAME;
+    classes['.'] = CHAR_DOT;
+    return classes;
+}
+
+static constexpr std::array<uint8_t, 256> CHAR_CLASSES = makeCharClasses();
+
+// Bit i is set if the character i of the 16 byte chunk is in the classes
+static inline uint32_t tableClassMask(const char *chunk, uint8_t classes) {
+    uint32_t mask = 0;
+    for (uint32_t i = 0; i < 16; ++i) {
+        mask |= (uint32_t)((CHAR_CLASSES[(uint8_t)chunk[i]] & classes) != 0)
+                << i;
+    }
+    return mask;
+}
+
+#ifdef __SSE2__
+// Same as tableClassMask, for the 16 characters at once
+static inline uint32_t sse2ClassMask(const char *chunk, uint8_t classes) {
+    // The bytes over 127 are negative, so they are never in a range
+    auto inRange = [](__m128i v, char lo, char hi) {
+        return _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8((char)(lo - 1))),
+                             _mm_cmplt_epi8(v, _mm_set1_epi8((char)(hi + 1))));
+    };
+    __m128i v = _mm_loadu_si128((const __m128i *)(const void *)chunk);
+    __m128i in = _mm_setzero_si128();
+    if (classes & CHAR_DIGIT) {
+        in = _mm_or_si128(in, inRange(v, '0', '9'));
+    }
+    if (classes & CHAR_ALPHA) {
+        // setting bit 5 maps the uppercase letters to the lowercase ones
+        __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+        in = _mm_or_si128(in, inRange(lower, 'a', 'z'));
+    }
+    if (classes & CHAR_NAME) {
+        in = _mm_or_si128(in, _mm_cmpeq_epi8(v, _mm_set1_epi8('-')));
+        in = _mm_or_si128(in, _mm_cmpeq_epi8(v, _mm_set1_epi8('_')));
+    }
+    if (classes & CHAR_DOT) {
+        in = _mm_or_si128(in, _mm_cmpeq_epi8(v, _mm_set1_epi8('.')));
+    }
+    return (uint32_t)_mm_movemask_epi8(in);
+}
+#endif
+
+typedef uint32_t (*ClassMask)(const char *chunk, uint8_t classes);
+
+// Value of two digits, already known to be digits
+static inline uint32_t twoDigits(const char *digits) {
+    return (uint32_t)(digits[0] - '0') * 10 + (uint32_t)(digits[1] - '0');
+}
+
+// The validators over a way of classifying the characters, so that the ones
+// built with the lookup table are the same code with or without SSE2
+template <ClassMask classMask> struct Validators {
+    // Checks 16 characters at a time, the last chunk from a zero padded copy
+    static bool allInClass(std::string_view str, uint8_t classes) {
+        char chunk[16];
+        for (size_t i = 0; i < str.length(); i += 16) {
+            size_t len = std::min(str.length() - i, (size_t)16);
+            memset(chunk, 0, sizeof(chunk));
+            memcpy(chunk, str.data() + i, len);
+            uint32_t want = (1U << len) - 1;
+            if ((classMask(chunk, classes) & want) != want) {
+                return false;
+            }
         }
+        return true;
+    }
+
+    static bool isUID(std::string_view uid) {
+        return uid.length() == UID_LEN && allInClass(uid, CHAR_DIGIT);
+    }
+
+    static bool isPassword(std::string_view password) {
+        return password.length() == PASSWORD_LEN &&
+               allInClass(password, CHAR_ALNUM);
+    }
+
+    static bool isAID(std::string_view aid) {
+        return aid.length() == AID_LEN && allInClass(aid, CHAR_DIGIT);
+    }
+
+    static bool isAuctionName(std::string_view auctionName) {
+        return auctionName.length() <= MAX_AUCTION_NAME_LEN &&
+               allInClass(auctionName, CHAR_ALNUM | CHAR_NAME);
+    }
+
+    static bool isFileName(std::string_view fName) {
+        size_t len = fName.length();
+        // An extension of FILE_EXTENSION_LEN characters, when it fits
+        return len <= MAX_FILE_NAME_LEN &&
+               allInClass(fName, CHAR_ALNUM | CHAR_NAME | CHAR_DOT) &&
+               (len < FILE_EXTENSION_LEN + 1 ||
+                fName[len - FILE_EXTENSION_LEN - 1] == '.');
+    }
+
+    static bool isCalDate(std::string_view calDate) {
+        // YYYY-MM-DD
+        char chunk[16] = {0};
+        if (calDate.length() != CAL_DATE_LEN) {
+            return false;
+        }
+        memcpy(chunk, calDate.data(), CAL_DATE_LEN);
+        uint32_t month = twoDigits(chunk + 5), day = twoDigits(chunk + 8);
+        return (classMask(chunk, CHAR_DIGIT) & 0x3FF) == 0x36F &&
+               chunk[4] == '-' && chunk[7] == '-' && month >= 1 &&
+               month <= 12 && day >= 1 && day <= 31;
+    }
+
+    static bool isTimeDate(std::string_view timeDate) {
+        // HH:MM:SS, with room for a leap second
+        char chunk[16] = {0};
+        if (timeDate.length() != TIME_DATE_LEN) {
+            return false;
+        }
+        memcpy(chunk, timeDate.data(), TIME_DATE_LEN);
+        return (classMask(chunk, CHAR_DIGIT) & 0xFF) == 0xDB &&
+               chunk[2] == ':' && chunk[5] == ':' && twoDigits(chunk) <= 23 &&
+               twoDigits(chunk + 3) <= 59 && twoDigits(chunk + 6) <= 60;
+    }
+};
+
+#ifdef __SSE2__
+typedef Validators<sse2ClassMask> FieldValidators;
+#else
+typedef Validators<tableClassMask> FieldValidators;
+#endif
+typedef Validators<tableClassMask> TableValidators;
+
+bool isUID(std::string_view uid) { return FieldValidators::isUID(uid); }
+
+bool isPassword(std::string_view password) {
+    return FieldValidators::isPassword(password);
+}
+
+bool isAID(std::string_view aid) { return FieldValidators::isAID(aid); }
+
+bool isAuctionName(std::string_view auctionName) {
+    return FieldValidators::isAuctionName(auctionName);
+}
+
+bool isFileName(std::string_view fName) {
+    return FieldValidators::isFileName(fName);
+}
+
+bool isCalDate(std::string_view calDate) {
+    return FieldValidators::isCalDate(calDate);
+}
+
+bool isTimeDate(std::string_view timeDate) {
+    return FieldValidators::isTimeDate(timeDate);
+}
+
+bool lookup::isUID(std::string_view uid) { return TableValidators::isUID(uid); }
+
+bool lookup::isPassword(std::string_view password) {
+    return TableValidators::isPassword(password);
+}
+
+bool lookup::isAID(std::string_view aid) { return TableValidators::isAID(aid); }
+
+bool lookup::isAuctionName(std::string_view auctionName) {
+    return TableValidators::isAuctionName(auctionName);
+}
+
+bool lookup::isFileName(std::string_view fName) {
+    return TableValidators::isFileName(fName);
+}
+
+bool lookup::isCalDate(std::string_view calDate) {
+    return TableValidators::isCalDate(calDate);
+}
+
+bool lookup::isTimeDate(std::string_view timeDate) {
+    return TableValidators::isTimeDate(timeDate);
+}
+
+int checkUID(std::string_view uid) {
+    if (!isUID(uid)) {
+        std::cerr << UID_ERR << std::endl;
+        return 1;
     }
     return 0;
 }
 
-int checkPassword(std::string password) {
-    if (password.length() != PASSWORD_LEN) {
+int checkPassword(std::string_view password) {
+    if (!isPassword(password)) {
         std::cerr << PASSWORD_ERR << std::endl;
         return 1;
     }
-    for (char c : password) {
-        if (!isalnum(c)) {
-            std::cerr << PASSWORD_ERR << std::endl;
-            return 1;
-        }
-    }
     return 0;
 }
 
-int checkAID(std::string aid) {
-    if (aid.length() != AID_LEN) {
+int checkAID(std::string_view aid) {
+    if (!isAID(aid)) {
         std::cerr << AID_ERR << std::endl;
         return 1;
     }
-    for (char c : aid) {
-        if (!isdigit(c)) {
-            std::cerr << AID_ERR << std::endl;
-            return 1;
-        }
-    }
     return 0;
 }
 
-int checkAuctionName(std::string auctionName) {
-    if (auctionName.length() > MAX_AUCTION_NAME_LEN) {
+int checkAuctionName(std::string_view auctionName) {
+    if (!isAuctionName(auctionName)) {
         std::cerr << NAME_ERR << std::endl;
         return 1;
     }
-    for (char c : auctionName) {
-        if (!isalnum(c) && c != '-' && c != '_') {
-            std::cerr << NAME_ERR << std::endl;
-            return 1;
-        }
-    }
     return 0;
 }
 
@@ -121,41 +396,24 @@ int checkFilePath(std::string fPath) {
     return 0;
 }
 
-int checkFileName(std::string fName) {
-    size_t fNameLen = fName.length();
-    if (fNameLen > MAX_FILE_NAME_LEN) {
+int checkFileName(std::string_view fName) {
+    if (!isFileName(fName)) {
         std::cerr << FILE_NAME_ERR << std::endl;
         return 1;
     }
-    char c;
-    for (size_t i = 0; i < fNameLen; ++i) {
-        c = fName.at(i);
-        if (!isalnum(c) && c != '-' && c != '_' && c != '.') {
-            std::cerr << FILE_NAME_ERR << std::endl;
-            return 1;
-        }
-        if (i == fNameLen - FILE_EXTENSION_LEN - 1 && c != '.') {
-            std::cerr << FILE_NAME_ERR << std::endl;
-            return 1;
-        }
-    }
     return 0;
 }
 
-int checkCalDate(std::string calDate) {
-    struct tm t;
-    if (calDate.empty() || calDate.length() != CAL_DATE_LEN ||
-        !strptime(calDate.c_str(), "%Y-%m-%d", &t)) {
+int checkCalDate(std::string_view calDate) {
+    if (!isCalDate(calDate)) {
         std::cerr << CAL_DATE_ERR << std::endl;
         return 1;
     }
     return 0;
 }
 
-int checkTimeDate(std::string timeDate) {
-    struct tm t;
-    if (timeDate.empty() || timeDate.length() != TIME_DATE_LEN ||
-        !strptime(timeDate.c_str(), "%H:%M:%S", &t)) {
+int checkTimeDate(std::string_view timeDate) {
+    if (!isTimeDate(timeDate)) {
         std::cerr << TIME_DATE_ERR << std::endl;
         return 1;
     }
@@ -2,8 +2,10 @@
 #define __UTILS_HPP__
 
 #include <cstdint>
+#include <ctime>
 #include <netdb.h>
 #include <string>
+#include <string_view>
 
 class Address {
   public:
@@ -12,40 +14,92 @@ class Address {
     socklen_t addrlen = sizeof(addr);
 };
 
+// Fixed width records, their text is only produced when they are serialized
+// or printed
 typedef struct {
-    std::string AID;
+    uint32_t AID;
     uint8_t state;
 } Auction;
 
 typedef struct {
-    std::string bidderUID;
+    time_t time; // seconds since the epoch
+    uint32_t bidderUID;
     uint32_t value;
-    std::string calDate;
-    std::string timeDate;
     uint32_t secTime;
 } Bid;
 
-int toInt(std::string intStr, uint32_t &num);
+// Parses a number with at most maxDigits digits and up to maxNum, returns 1
+// if the string is anything else
+int toInt(std::string_view intStr, uint32_t &num, size_t maxDigits = 10,
+          uint32_t maxNum = INT32_MAX);
+
+// Appends the decimal representation of the number, without a heap allocation
+// for the digits as with std::to_string
+void appendInt(std::string &str, uint64_t num);
+
+// CRC-32 (the one of zlib) of the data, continuing from crc for data that
+// comes in parts
+uint32_t crc32(const char *data, size_t len, uint32_t crc = 0);
+
+// Zero padded representation of fixed width numbers, like AIDs and UIDs
+std::string toDigits(uint32_t num, size_t width);
+
+// Writes the "YYYY-MM-DD HH:MM:SS" representation, without a null terminator
+void formatDate(time_t seconds, char *date);
 
 std::string toDate(time_t seconds);
 
+// Inverse of toDate, returns 1 if the date is invalid
+int parseDate(std::string date, time_t &seconds);
+
 int checkPort(std::string port);
 
-int checkUID(std::string uid);
+// Silent validators of the fields of the packets, for the server
+
+bool isUID(std::string_view uid);
+
+bool isPassword(std::string_view password);
+
+bool isAID(std::string_view aid);
+
+bool isAuctionName(std::string_view auctionName);
+
+// The extension, if the name is long enough for one, must have 3 characters
+bool isFileName(std::string_view fName);
+
+bool isCalDate(std::string_view calDate);
+
+bool isTimeDate(std::string_view timeDate);
+
+// The same validators classifying the characters one at a time with a lookup
+// table, which is how they are built without SSE2. For the benchmarks.
+namespace lookup {
+bool isUID(std::string_view uid);
+bool isPassword(std::string_view password);
+bool isAID(std::string_view aid);
+bool isAuctionName(std::string_view auctionName);
+bool isFileName(std::string_view fName);
+bool isCalDate(std::string_view calDate);
+bool isTimeDate(std::string_view timeDate);
+} // namespace lookup
+
+// Same validators, printing what is wrong to the user. Return 1 if invalid.
+
+int checkUID(std::string_view uid);
 
-int checkPassword(std::string password);
+int checkPassword(std::string_view password);
 
-int checkAID(std::string aid);
+int checkAID(std::string_view aid);
 
-int checkAuctionName(std::string auctionName);
+int checkAuctionName(std::string_view auctionName);
 
 int checkFilePath(std::string fPath);
 
-int checkFileName(std::string fName);
+int checkFileName(std::string_view fName);
 
-int checkCalDate(std::string calDate);
+int checkCalDate(std::string_view calDate);
 
-int checkTimeDate(std::string timeDate);
+int checkTimeDate(std::string_view timeDate);
 
 void setupSigHandlers(void (*sigF)(int));
 
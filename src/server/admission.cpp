@@ -0,0 +1,67 @@
+#include "admission.hpp"
+#include "../lib/constants.hpp"
+#include "../lib/utils.hpp"
+#include "timers.hpp"
+
+#include <algorithm>
+
+bool TokenBucket::take(uint64_t now) {
+    if (this->rate == 0) {
+        return true;
+    }
+    uint64_t burst = (uint64_t)this->rate * 1000;
+    if (this->last == 0) {
+        this->tokens = burst;
+    } else {
+        this->tokens =
+            std::min(burst, this->tokens + (now - this->last) * this->rate);
+    }
+    this->last = now;
+    if (this->tokens < 1000) {
+        return false;
+    }
+    this->tokens -= 1000;
+    return true;
+}
+
+int Admission::setLimit(const std::string &spec) {
+    size_t sep = spec.find('=');
+    if (sep == std::string::npos) {
+        return 1;
+    }
+    std::string name = spec.substr(0, sep);
+    uint32_t rate;
+    if (toInt(spec.substr(sep + 1), rate)) {
+        return 1;
+    }
+    for (size_t i = 0; i < NUM_ADMIT_CLASSES; ++i) {
+        if (name == ADMIT_CLASS_NAMES[i]) {
+            this->buckets[i].rate = rate;
+            return 0;
+        }
+    }
+    return 1;
+}
+
+bool Admission::admit(const std::string &packetID) {
+    AdmissionClass admitClass = admissionClass(packetID);
+    if (admitClass == ADMIT_ALWAYS) {
+        return true;
+    }
+    return this->buckets[admitClass].take(monotonicMillis());
+}
+
+AdmissionClass admissionClass(const std::string &packetID) {
+    std::string id = packetID.substr(0, PACKET_ID_LEN);
+    if (id == "LIN" || id == "LOU" || id == "UNR" || id == "LMA" ||
+        id == "LMB" || id == "LST" || id == "LPG" || id == "LFL" ||
+        id == "SRC" || id == "SRD") {
+        return ADMIT_QUERY;
+    } else if (id == "CLS" || id == "BID" || id == "SUB") {
+        return ADMIT_CONTROL;
+    } else if (id == "OPA" || id == "SAS" || id == "SAR" || id == "UPS" ||
+               id == "UPC" || id == "OPC") {
+        return ADMIT_TRANSFER;
+    }
+    return ADMIT_ALWAYS;
+}
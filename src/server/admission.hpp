@@ -0,0 +1,42 @@
+#ifndef __ADMISSION_HPP__
+#define __ADMISSION_HPP__
+
+#include <cstdint>
+#include <string>
+
+// Requests are limited per class, so that cheap lookups can't be starved by
+// uploads and downloads, and the other way around
+enum AdmissionClass {
+    ADMIT_QUERY,    // UDP requests
+    ADMIT_CONTROL,  // CLS, BID, SUB
+    ADMIT_TRANSFER, // OPA, SAS, SAR, UPS, UPC, OPC
+    NUM_ADMIT_CLASSES,
+    ADMIT_ALWAYS // STA and unknown requests
+};
+
+constexpr const char *ADMIT_CLASS_NAMES[] = {"query", "control", "transfer"};
+
+// Allows rate requests per second on average, in bursts of up to rate
+class TokenBucket {
+  public:
+    uint32_t rate = 0; // 0 is unlimited
+
+    bool take(uint64_t now);
+
+  private:
+    uint64_t tokens = 0; // in thousandths of a request
+    uint64_t last = 0;   // monotonic milliseconds of the last refill
+};
+
+class Admission {
+  public:
+    TokenBucket buckets[NUM_ADMIT_CLASSES];
+
+    // Parses "<class>=<requests per second>", returns 1 if it's invalid
+    int setLimit(const std::string &spec);
+    bool admit(const std::string &packetID);
+};
+
+AdmissionClass admissionClass(const std::string &packetID);
+
+#endif // __ADMISSION_HPP__
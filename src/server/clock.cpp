@@ -0,0 +1,21 @@
+#include "clock.hpp"
+#include "../lib/utils.hpp"
+
+CoarseClock serverClock;
+
+void CoarseClock::tick() {
+    this->seconds.store(time(NULL), std::memory_order_relaxed);
+}
+
+time_t CoarseClock::now() {
+    return this->seconds.load(std::memory_order_relaxed);
+}
+
+const std::string &CoarseClock::date() {
+    time_t current = this->now();
+    if (current != this->dateSeconds) {
+        this->cachedDate = toDate(current);
+        this->dateSeconds = current;
+    }
+    return this->cachedDate;
+}
@@ -0,0 +1,25 @@
+#ifndef __CLOCK_HPP__
+#define __CLOCK_HPP__
+
+#include <atomic>
+#include <ctime>
+#include <string>
+
+// Wall clock that only moves when the listener loop ticks it, so every
+// timestamp taken while handling the same event agrees and costs no syscall
+class CoarseClock {
+  public:
+    void tick();
+    time_t now();
+    // toDate(now()), formatted at most once per tick (listener thread only)
+    const std::string &date();
+
+  private:
+    std::atomic<time_t> seconds{0};
+    time_t dateSeconds = -1;
+    std::string cachedDate;
+};
+
+extern CoarseClock serverClock;
+
+#endif // __CLOCK_HPP__
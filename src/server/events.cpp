@@ -0,0 +1,62 @@
+#include "events.hpp"
+#include "table.hpp"
+
+#include <algorithm>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <vector>
+
+int EventBus::subscribe(int fd, uint32_t AID) {
+    int flags = fcntl(fd, F_GETFL);
+    if (flags == -1 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) == -1) {
+        return 0;
+    }
+    this->subscriptions[fd] = {AID, false};
+    return 1;
+}
+
+void EventBus::unsubscribe(int fd) { this->subscriptions.erase(fd); }
+
+bool EventBus::isSubscribed(int fd) {
+    return this->subscriptions.find(fd) != this->subscriptions.end();
+}
+
+void EventBus::publish(EVTPacket &event) {
+    for (auto &[fd, sub] : this->subscriptions) {
+        if (sub.failed || (sub.AID != 0 && sub.AID != event.AID)) {
+            continue;
+        }
+        if (event.serialize(fd)) {
+            // Wakes the listener, which drops the connection
+            sub.failed = true;
+            shutdown(fd, SHUT_RDWR);
+        }
+    }
+}
+
+void EventBus::publishEnded(time_t now) {
+    uint32_t last = this->lastEnded;
+    this->lastEnded = (uint32_t)now;
+    if (last == 0 || this->subscriptions.empty()) {
+        return;
+    }
+    std::vector<uint32_t> AIDs;
+    auctionTable->endIndex.endingBetween(last, (uint32_t)now, AIDs);
+    for (uint32_t AID : AIDs) {
+        EVTPacket event;
+        event.kind = EVENT_CLOSED;
+        event.AID = AID;
+        this->publish(event);
+    }
+}
+
+int64_t EventBus::timeout(time_t now) {
+    if (this->subscriptions.empty()) {
+        return -1;
+    }
+    uint32_t next = auctionTable->endIndex.nextEnd(this->lastEnded);
+    if (next == 0) {
+        return -1;
+    }
+    return std::max(((int64_t)next - (int64_t)now) * 1000, (int64_t)0);
+}
@@ -0,0 +1,38 @@
+#ifndef __EVENTS_HPP__
+#define __EVENTS_HPP__
+
+#include "../lib/protocol.hpp"
+
+#include <cstdint>
+#include <ctime>
+#include <unordered_map>
+
+typedef struct {
+    uint32_t AID; // 0 for every auction
+    bool failed;  // could not keep up, dropped by the listener
+} Subscription;
+
+// TCP connections kept open to be pushed the events of the auctions, instead
+// of polling for them. Only the TCP listener, which makes every change to the
+// auctions, publishes to them.
+class EventBus {
+  public:
+    // The socket is made non blocking, so a subscriber that stops reading is
+    // dropped instead of stalling the listener. Returns 0 if it can't be.
+    int subscribe(int fd, uint32_t AID);
+    void unsubscribe(int fd);
+    bool isSubscribed(int fd);
+    bool empty() { return subscriptions.empty(); }
+    void publish(EVTPacket &event);
+    // Publishes the auctions that reached their end time since the last call
+    void publishEnded(time_t now);
+    // milliseconds from now, a time of the coarse clock, until the next
+    // auction ends, or -1 if no one is listening or no auction is active
+    int64_t timeout(time_t now);
+
+  private:
+    std::unordered_map<int, Subscription> subscriptions; // by fd
+    uint32_t lastEnded = 0;
+};
+
+#endif // __EVENTS_HPP__
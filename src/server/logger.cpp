@@ -0,0 +1,159 @@
+#include "logger.hpp"
+#include "../lib/utils.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <unistd.h>
+
+// There is a single logger per process, so one ring per thread is enough
+static thread_local LogRing *ring = NULL;
+
+static const char *levelNames[] = {"ERR ", "WARN", "INFO", "DBG "};
+
+static uint64_t nowMicros() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+int Logger::openFile(const std::string &path) {
+    int newFd = open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (newFd == -1) {
+        return 1;
+    }
+    if (this->fd != STDOUT_FILENO) {
+        close(this->fd);
+    }
+    this->fd = newFd;
+    return 0;
+}
+
+LogRing &Logger::localRing() {
+    if (ring == NULL) {
+        std::unique_ptr<LogRing> newRing = std::make_unique<LogRing>();
+        newRing->pending.len = 0;
+        ring = newRing.get();
+        std::lock_guard<std::mutex> guard(this->ringsLock);
+        this->rings.push_back(std::move(newRing));
+    }
+    return *ring;
+}
+
+void Logger::append(const char *str, size_t len) {
+    LogRecord &record = localRing().pending;
+    len = std::min(len, (size_t)LOG_RECORD_LEN - record.len);
+    memcpy(record.text + record.len, str, len);
+    record.len = (uint16_t)(record.len + len);
+}
+
+void Logger::commit(LogLevel lvl) {
+    LogRing &r = localRing();
+    LogRecord &record = r.pending;
+    record.level = lvl;
+    record.timestamp = nowMicros();
+
+    uint64_t window = record.timestamp / 1000000;
+    if (window != r.window) {
+        r.window = window;
+        r.windowCount = 0;
+    }
+    uint64_t head = r.head.load(std::memory_order_relaxed);
+    if (this->rateLimit != 0 && ++r.windowCount > this->rateLimit) {
+        r.suppressed.fetch_add(1, std::memory_order_relaxed);
+    } else if (head - r.tail.load(std::memory_order_acquire) >=
+               LOG_RING_RECORDS) {
+        r.dropped.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        r.records[head % LOG_RING_RECORDS] = record;
+        r.head.store(head + 1, std::memory_order_release);
+    }
+    record.len = 0;
+}
+
+static void formatRecord(std::string &batch, const LogRecord &record) {
+    char prefix[DATE_LEN + 16];
+    formatDate((time_t)(record.timestamp / 1000000), prefix);
+    int n = snprintf(prefix + DATE_LEN, sizeof(prefix) - DATE_LEN, ".%06u %s ",
+                     (unsigned)(record.timestamp % 1000000),
+                     levelNames[record.level]);
+    batch.append(prefix, DATE_LEN + (size_t)n);
+    batch.append(record.text, record.len);
+    batch.push_back('\n');
+}
+
+size_t Logger::drain() {
+    size_t drained = 0;
+    uint64_t drops = 0, suppressed = 0;
+    {
+        std::lock_guard<std::mutex> guard(this->ringsLock);
+        for (std::unique_ptr<LogRing> &r : this->rings) {
+            uint64_t tail = r->tail.load(std::memory_order_relaxed);
+            uint64_t head = r->head.load(std::memory_order_acquire);
+            for (; tail < head; ++tail, ++drained) {
+                formatRecord(this->batch, r->records[tail % LOG_RING_RECORDS]);
+            }
+            r->tail.store(tail, std::memory_order_release);
+            drops += r->dropped.load(std::memory_order_relaxed);
+            suppressed += r->suppressed.load(std::memory_order_relaxed);
+        }
+    }
+    uint64_t newDrops = drops - this->reportedDrops;
+    uint64_t newSuppressed = suppressed - this->reportedSuppressed;
+    if (newDrops > 0 || newSuppressed > 0) {
+        LogRecord record;
+        record.timestamp = nowMicros();
+        record.level = LOG_WARN;
+        int n = snprintf(record.text, LOG_RECORD_LEN,
+                         "Logger dropped %lu records (ring full) and "
+                         "suppressed %lu records (rate limit)",
+                         (unsigned long)newDrops, (unsigned long)newSuppressed);
+        record.len = (uint16_t)std::min(n, LOG_RECORD_LEN - 1);
+        formatRecord(this->batch, record);
+        this->reportedDrops = drops;
+        this->reportedSuppressed = suppressed;
+    }
+
+    const char *ptr = this->batch.c_str();
+    size_t left = this->batch.length();
+    while (left > 0) {
+        ssize_t n = write(this->fd, ptr, left);
+        if (n <= 0) {
+            break; // nowhere left to report it
+        }
+        ptr += n;
+        left -= (size_t)n;
+    }
+    this->batch.clear();
+    return drained;
+}
+
+void Logger::start() {
+    if (this->running.exchange(true)) {
+        return;
+    }
+    this->drainer = std::thread([this]() {
+        while (this->running.load(std::memory_order_relaxed)) {
+            if (this->drain() == 0) {
+                std::this_thread::sleep_for(
+                    std::chrono::milliseconds(LOG_DRAIN_INTERVAL_MS));
+            }
+        }
+    });
+}
+
+void Logger::stop() {
+    if (this->running.exchange(false)) {
+        this->drainer.join();
+    }
+    this->drain();
+}
+
+Logger::~Logger() {
+    this->stop();
+    if (this->fd != STDOUT_FILENO) {
+        close(this->fd);
+    }
+}
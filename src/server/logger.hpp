@@ -0,0 +1,109 @@
+#ifndef __LOGGER_HPP__
+#define __LOGGER_HPP__
+
+#include "../lib/constants.hpp"
+
+#include <atomic>
+#include <charconv>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <unistd.h>
+#include <vector>
+
+enum LogLevel : uint8_t { LOG_ERR, LOG_WARN, LOG_INFO, LOG_DEBUG };
+
+typedef struct {
+    uint64_t timestamp; // microseconds since the epoch
+    LogLevel level;
+    uint16_t len;
+    char text[LOG_RECORD_LEN];
+} LogRecord;
+
+// Written only by the thread that owns it and read only by the drain thread
+class LogRing {
+  public:
+    LogRecord records[LOG_RING_RECORDS];
+    std::atomic<uint64_t> head{0}; // next record to be written
+    std::atomic<uint64_t> tail{0}; // next record to be drained
+    std::atomic<uint64_t> dropped{0};
+    std::atomic<uint64_t> suppressed{0};
+
+    // used only by the owning thread
+    LogRecord pending;
+    uint64_t window = 0; // current rate limiting second
+    uint32_t windowCount = 0;
+};
+
+class Logger {
+  public:
+    LogLevel level = LOG_WARN;
+    uint32_t rateLimit = LOG_RATE_LIMIT; // per thread and second, 0 is none
+    int fd = STDOUT_FILENO;
+
+    bool enabled(LogLevel lvl) { return lvl <= level; }
+    int openFile(const std::string &path);
+    void append(const char *str, size_t len);
+    void commit(LogLevel lvl);
+    void start();
+    void stop();
+    size_t drain();
+    ~Logger();
+
+  private:
+    std::mutex ringsLock;
+    std::vector<std::unique_ptr<LogRing>> rings;
+    std::atomic<bool> running{false};
+    std::thread drainer;
+    std::string batch;
+    uint64_t reportedDrops = 0;
+    uint64_t reportedSuppressed = 0;
+
+    LogRing &localRing();
+};
+
+class VerboseStream {
+  public:
+    Logger &logger;
+    LogLevel level;
+
+    VerboseStream(Logger &log, LogLevel lvl) : logger(log), level(lvl) {}
+
+    template <class T> VerboseStream &operator<<(const T &rhs) {
+        if (!logger.enabled(level)) {
+            return *this;
+        }
+        if constexpr (std::is_convertible_v<const T &, std::string_view>) {
+            std::string_view str(rhs);
+            logger.append(str.data(), str.length());
+        } else if constexpr (std::is_same_v<T, char>) {
+            logger.append(&rhs, 1);
+        } else if constexpr (std::is_integral_v<T>) {
+            char buffer[24];
+            auto res = std::to_chars(buffer, buffer + sizeof(buffer), rhs);
+            logger.append(buffer, (size_t)(res.ptr - buffer));
+        } else {
+            std::ostringstream stream;
+            stream << rhs;
+            std::string str = stream.str();
+            logger.append(str.c_str(), str.length());
+        }
+        return *this;
+    }
+    // Ends the record, which is then handed to the drain thread
+    VerboseStream &operator<<(std::ostream &(*pf)(std::ostream &)) {
+        (void)pf; // not used, std::endl is the only manipulator in use
+        if (logger.enabled(level)) {
+            logger.commit(level);
+        }
+        return *this;
+    }
+};
+
+#endif // __LOGGER_HPP__
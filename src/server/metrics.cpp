@@ -0,0 +1,178 @@
+#include "metrics.hpp"
+
+#include <cctype>
+#include <cstring>
+#include <linux/tcp.h>
+#include <netinet/in.h>
+#include <new>
+#include <sys/mman.h>
+#include <sys/socket.h>
+
+static inline void bump(Counter &counter, uint64_t n = 1) {
+    counter.store(counter.load(std::memory_order_relaxed) + n,
+                  std::memory_order_relaxed);
+}
+
+static inline uint64_t get(const Counter &counter) {
+    return counter.load(std::memory_order_relaxed);
+}
+
+// The last entry of names is the catch-all for unknown values
+static size_t lookup(const char *const names[], size_t numNames,
+                     const std::string &name) {
+    for (size_t i = 0; i < numNames - 1; ++i) {
+        size_t len = strlen(names[i]);
+        if (name.compare(0, len, names[i]) == 0 &&
+            (name.length() == len || isspace(name.at(len)))) {
+            return i;
+        }
+    }
+    return numNames - 1;
+}
+
+static size_t latencyBucket(uint64_t micros) {
+    if (micros < LATENCY_SUB_BUCKETS) {
+        return (size_t)micros;
+    }
+    size_t exp = (size_t)(63 - __builtin_clzll(micros));
+    size_t sub = (size_t)(micros >> (exp - 2)) & (LATENCY_SUB_BUCKETS - 1);
+    size_t bucket = (exp - 1) * LATENCY_SUB_BUCKETS + sub;
+    return bucket < LATENCY_BUCKETS ? bucket : LATENCY_BUCKETS - 1;
+}
+
+static uint64_t bucketLowerBound(size_t bucket) {
+    if (bucket < LATENCY_SUB_BUCKETS) {
+        return bucket;
+    }
+    size_t exp = bucket / LATENCY_SUB_BUCKETS + 1;
+    uint64_t sub = bucket % LATENCY_SUB_BUCKETS;
+    return (LATENCY_SUB_BUCKETS + sub) << (exp - 2);
+}
+
+void MetricsShard::countRequest(const std::string &packetID, uint64_t micros) {
+    size_t op = lookup(METRIC_OPCODES, NUM_METRIC_OPCODES, packetID);
+    bump(requests[op]);
+    bump(latencySum[op], micros);
+    bump(latency[op][latencyBucket(micros)]);
+}
+
+void MetricsShard::countReply(const std::string &status) {
+    bump(replies[lookup(METRIC_STATUSES, NUM_METRIC_STATUSES, status)]);
+}
+
+void MetricsShard::countBytes(uint64_t in, uint64_t out) {
+    bump(bytesIn, in);
+    bump(bytesOut, out);
+}
+
+void MetricsShard::openConnection() {
+    bump(accepted);
+    bump(connections);
+}
+
+void MetricsShard::closeConnection(const int fd) {
+    struct tcp_info info;
+    socklen_t len = sizeof(info);
+    memset(&info, 0, sizeof(info));
+    if (getsockopt(fd, IPPROTO_TCP, TCP_INFO, &info, &len) == 0) {
+        countBytes(info.tcpi_bytes_received,
+                   info.tcpi_bytes_sent - info.tcpi_bytes_retrans);
+    }
+    connections.store(get(connections) - 1, std::memory_order_relaxed);
+}
+
+void MetricsShard::timeoutConnection(const int fd) {
+    bump(timedOut);
+    closeConnection(fd);
+}
+
+void MetricsShard::refuseConnection() { bump(refused); }
+
+void MetricsShard::shedRequest() { bump(shed); }
+
+void MetricsShard::cacheHit() { bump(cached); }
+
+std::string Metrics::report() {
+    std::string msg;
+    const char *shardNames[NUM_SHARDS] = {"udp", "tcp"};
+    for (size_t s = 0; s < NUM_SHARDS; ++s) {
+        MetricsShard &shard = shards[s];
+        std::string name = shardNames[s];
+        msg += " " + name + ".in=" + std::to_string(get(shard.bytesIn)) + " " +
+               name + ".out=" + std::to_string(get(shard.bytesOut)) + " " +
+               name + ".shed=" + std::to_string(get(shard.shed));
+    }
+    msg += " udp.cached=" + std::to_string(get(shards[UDP_SHARD].cached));
+    MetricsShard &tcp = shards[TCP_SHARD];
+    msg += " tcp.conns=" + std::to_string(get(tcp.connections)) +
+           " tcp.accepted=" + std::to_string(get(tcp.accepted)) +
+           " tcp.timedout=" + std::to_string(get(tcp.timedOut)) +
+           " tcp.refused=" + std::to_string(get(tcp.refused));
+
+    for (size_t i = 0; i < NUM_METRIC_STATUSES; ++i) {
+        uint64_t count = 0;
+        for (size_t s = 0; s < NUM_SHARDS; ++s) {
+            count += get(shards[s].replies[i]);
+        }
+        if (count > 0) {
+            msg += " " + std::string(METRIC_STATUSES[i]) + "=" +
+                   std::to_string(count);
+        }
+    }
+
+    for (size_t op = 0; op < NUM_METRIC_OPCODES; ++op) {
+        uint64_t count = 0, sum = 0;
+        uint64_t buckets[LATENCY_BUCKETS] = {0};
+        for (size_t s = 0; s < NUM_SHARDS; ++s) {
+            count += get(shards[s].requests[op]);
+            sum += get(shards[s].latencySum[op]);
+            for (size_t b = 0; b < LATENCY_BUCKETS; ++b) {
+                buckets[b] += get(shards[s].latency[op][b]);
+            }
+        }
+        if (count == 0) {
+            continue;
+        }
+        std::string name = METRIC_OPCODES[op];
+        msg += " " + name + "=" + std::to_string(count) + " " + name +
+               ".avg_us=" + std::to_string(sum / count);
+
+        // Percentiles are reported as the lower bound of their bucket
+        uint64_t seen = 0, p50 = 0, p99 = 0;
+        uint64_t rank50 = (count + 1) / 2, rank99 = count - count / 100;
+        std::string hist;
+        for (size_t b = 0; b < LATENCY_BUCKETS; ++b) {
+            if (buckets[b] == 0) {
+                continue;
+            }
+            if (seen < rank50 && seen + buckets[b] >= rank50) {
+                p50 = bucketLowerBound(b);
+            }
+            if (seen < rank99 && seen + buckets[b] >= rank99) {
+                p99 = bucketLowerBound(b);
+            }
+            seen += buckets[b];
+            hist += (hist.empty() ? "" : ",") +
+                    std::to_string(bucketLowerBound(b)) + ":" +
+                    std::to_string(buckets[b]);
+        }
+        msg += " " + name + ".p50_us=" + std::to_string(p50) + " " + name +
+               ".p99_us=" + std::to_string(p99) + " " + name + ".hist=" + hist;
+    }
+    return msg.substr(1); // skip the leading space
+}
+
+Metrics *createMetrics() {
+    void *mem = mmap(NULL, sizeof(Metrics), PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) {
+        return NULL;
+    }
+    return new (mem) Metrics();
+}
+
+void destroyMetrics(Metrics *metrics) {
+    if (metrics != NULL) {
+        munmap(metrics, sizeof(Metrics));
+    }
+}
@@ -0,0 +1,77 @@
+#ifndef __METRICS_HPP__
+#define __METRICS_HPP__
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// Log-linear latency buckets (4 per power of two), in microseconds
+#define LATENCY_SUB_BUCKETS (4)
+#define LATENCY_BUCKETS (128)
+
+constexpr const char *METRIC_OPCODES[] = {
+    "LIN", "LOU", "UNR", "LMA", "LMB", "LST", "LPG", "LFL", "SRC", "SRD",
+    "STA", "OPA", "UPS", "UPC", "OPC", "CLS", "BID", "SAS", "SAR", "SUB",
+    "???"};
+constexpr size_t NUM_METRIC_OPCODES =
+    sizeof(METRIC_OPCODES) / sizeof(*METRIC_OPCODES);
+
+constexpr const char *METRIC_STATUSES[] = {"OK",  "NOK", "REG", "UNR", "NLG",
+                                           "EAU", "EOW", "END", "ACC", "REF",
+                                           "ILG", "UNC", "CRC", "ERR", "???"};
+constexpr size_t NUM_METRIC_STATUSES =
+    sizeof(METRIC_STATUSES) / sizeof(*METRIC_STATUSES);
+
+typedef std::atomic<uint64_t> Counter;
+static_assert(Counter::is_always_lock_free);
+
+// Each shard is only ever written by a single process (UDP or TCP listener),
+// so increments are plain relaxed stores instead of locked read-modify-writes.
+class MetricsShard {
+  public:
+    Counter requests[NUM_METRIC_OPCODES];
+    Counter latencySum[NUM_METRIC_OPCODES];
+    Counter latency[NUM_METRIC_OPCODES][LATENCY_BUCKETS];
+    Counter replies[NUM_METRIC_STATUSES];
+    Counter bytesIn;
+    Counter bytesOut;
+    Counter connections; // gauge
+    Counter accepted;
+    Counter timedOut;
+    Counter refused; // connections turned away at capacity
+    Counter shed;    // requests turned away by the rate limits
+    Counter cached;  // retransmitted requests answered from the reply cache
+
+    void countRequest(const std::string &packetID, uint64_t micros);
+    void countReply(const std::string &status);
+    void countBytes(uint64_t in, uint64_t out);
+    void openConnection();
+    void closeConnection(const int fd);
+    void timeoutConnection(const int fd);
+    void refuseConnection();
+    void shedRequest();
+    void cacheHit();
+};
+
+enum { UDP_SHARD, TCP_SHARD, NUM_SHARDS };
+
+class Metrics {
+  public:
+    MetricsShard shards[NUM_SHARDS];
+
+    std::string report();
+};
+
+inline uint64_t elapsedMicros(std::chrono::steady_clock::time_point start) {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now() - start)
+        .count();
+}
+
+// Must be called before forking so both listeners share the same counters
+Metrics *createMetrics();
+
+void destroyMetrics(Metrics *metrics);
+
+#endif // __METRICS_HPP__
@@ -1,37 +1,72 @@
 #include "packets.hpp"
 #include "../lib/messages.hpp"
 #include "../lib/protocol.hpp"
+#include "clock.hpp"
 #include "persistance.hpp"
 #include "server_state.hpp"
+#include "timers.hpp"
 
+#include <arpa/inet.h>
+#include <chrono>
 #include <iomanip>
+#include <poll.h>
 #include <sstream>
+#include <sys/socket.h>
 #include <unistd.h>
 
 UDPPacketsHandler UDPHandler = {{"LIN ", LINHandler}, {"LOU ", LOUHandler},
                                 {"UNR ", UNRHandler}, {"LMA ", LMAHandler},
                                 {"LMB ", LMBHandler}, {"LST\n", LSTHandler},
-                                {"SRC ", SRCHandler}};
+                                {"SRC ", SRCHandler}, {"STA\n", STAHandler},
+                                {"LPG ", LPGHandler}, {"LFL ", LFLHandler},
+                                {"SRD ", SRDHandler}};
 TCPPacketsHandler TCPHandler = {{"OPA ", OPAHandler},
+                                {"UPS ", UPSHandler},
+                                {"UPC ", UPCHandler},
+                                {"OPC ", OPCHandler},
                                 {"CLS ", CLSHandler},
                                 {"SAS ", SASHandler},
-                                {"BID ", BIDHandler}};
+                                {"SAR ", SARHandler},
+                                {"BID ", BIDHandler},
+                                {"SUB ", SUBHandler}};
 
 void interpretUDPPacket(ServerState &state, std::string msg, Address UDPFrom) {
+    auto start = std::chrono::steady_clock::now();
     std::string packetID = msg.substr(0, PACKET_ID_LEN + 1);
-    msg.erase(0, PACKET_ID_LEN + 1);
-
-    if (UDPHandler.find(packetID) == UDPHandler.end()) {
+    uint64_t now = monotonicMillis();
+    uint64_t version = auctionTable->version.load(std::memory_order_acquire);
+    time_t clock = serverClock.now();
+
+    const std::string *cached =
+        state.replies.find(UDPFrom.addr, msg, now, version, clock);
+    if (cached != NULL) {
+        // A retransmission, answered without handling it again
+        state.stats->cacheHit();
+        state.stats->countBytes(0, cached->length());
+        sendUDPMessage(*cached, (struct sockaddr *)&UDPFrom.addr,
+                       UDPFrom.addrlen, state.socketUDP);
+        state.cverbose << "| " << CACHED_REPLY << std::endl;
+    } else if (UDPHandler.find(packetID) == UDPHandler.end()) {
         ERRUDPPacket err;
-        sendUDPPacket(err, (struct sockaddr *)&UDPFrom.addr, UDPFrom.addrlen,
-                      state.socketUDP);
+        replyUDPPacket(state, err, "ERR", UDPFrom);
         state.cverbose << "| " << UNKNOWN_MSG << std::endl;
-        return;
+    } else if (!state.admission.admit(packetID)) {
+        shedUDPPacket(state, packetID, UDPFrom);
+    } else {
+        std::string request = msg;
+        msg.erase(0, PACKET_ID_LEN + 1);
+        UDPHandler[packetID](state, msg, UDPFrom);
+        if (packetID != "STA\n") { // the metrics change with every request
+            time_t endsAt = auctionTable->endIndex.nextEnd((uint32_t)clock);
+            state.replies.store(UDPFrom.addr, request, state.lastReply, now,
+                                version, endsAt);
+        }
     }
-    UDPHandler[packetID](state, msg, UDPFrom);
+    state.stats->countRequest(packetID, elapsedMicros(start));
 }
 
 void interpretTCPPacket(ServerState &state, const int fd) {
+    auto start = std::chrono::steady_clock::now();
     char c;
     std::string packetID;
     int n = PACKET_ID_LEN + 1;
@@ -42,11 +77,63 @@ void interpretTCPPacket(ServerState &state, const int fd) {
     if (packetID.length() != PACKET_ID_LEN + 1 ||
         TCPHandler.find(packetID) == TCPHandler.end()) {
         ERRTCPPacket err;
-        err.serialize(fd);
+        replyTCPPacket(state, err, "ERR", fd);
         state.cverbose << "| " << UNKNOWN_MSG << std::endl;
-        return;
+    } else if (!state.admission.admit(packetID)) {
+        shedTCPPacket(state, packetID, fd);
+    } else {
+        TCPHandler[packetID](state, fd);
+    }
+    state.stats->countRequest(packetID, elapsedMicros(start));
+}
+
+// Over the limit requests get a plain ERR without touching the data base
+void shedUDPPacket(ServerState &state, const std::string &packetID,
+                   Address &UDPFrom) {
+    ERRUDPPacket err;
+    replyUDPPacket(state, err, "ERR", UDPFrom);
+    state.stats->shedRequest();
+    state.cwarn << REQUEST_SHED(ADMIT_CLASS_NAMES[admissionClass(packetID)])
+                << std::endl;
+}
+
+void shedTCPPacket(ServerState &state, const std::string &packetID,
+                   const int fd) {
+    ERRTCPPacket err;
+    replyTCPPacket(state, err, "ERR", fd);
+    drainTCPSocket(fd);
+    state.stats->shedRequest();
+    state.cwarn << REQUEST_SHED(ADMIT_CLASS_NAMES[admissionClass(packetID)])
+                << std::endl;
+}
+
+void replyUDPPacket(ServerState &state, UDPPacket &packet,
+                    const std::string &status, Address &UDPTo) {
+    state.lastReply = packet.serialize();
+    state.stats->countReply(status);
+    state.stats->countBytes(0, state.lastReply.length());
+    sendUDPMessage(state.lastReply, (struct sockaddr *)&UDPTo.addr,
+                   UDPTo.addrlen, state.socketUDP);
+}
+
+void replyTCPPacket(ServerState &state, TCPPacket &packet,
+                    const std::string &status, const int fd) {
+    state.stats->countReply(status);
+    packet.serialize(fd);
+}
+
+void drainTCPSocket(const int fd) {
+    shutdown(fd, SHUT_WR);
+    uint64_t deadline = monotonicMillis() + DRAIN_TIMEOUT_MS;
+    char buffer[4096];
+    struct pollfd pfd = {fd, POLLIN, 0};
+    for (uint64_t now = monotonicMillis(); now < deadline;
+         now = monotonicMillis()) {
+        if (poll(&pfd, 1, (int)(deadline - now)) <= 0 ||
+            recv(fd, buffer, sizeof(buffer), 0) <= 0) {
+            return; // nothing more arrived, or the user closed it
+        }
     }
-    TCPHandler[packetID](state, fd);
 }
 
 void LINHandler(ServerState &state, std::string msg, Address UDPFrom) {
@@ -63,18 +150,19 @@ void LINHandler(ServerState &state, std::string msg, Address UDPFrom) {
         if (checkRegister(packetIn.UID)) {
             if (checkLoginMatch(packetIn.UID, packetIn.password) &&
                 loginUser(packetIn.UID)) {
+                state.replies.changedUsers();
                 packetOut.status = "OK";
             } else {
                 packetOut.status = "NOK";
             }
         } else if (registerUser(packetIn.UID, packetIn.password)) {
+            state.replies.changedUsers();
             packetOut.status = "REG";
         } else {
             packetOut.status = "ERR";
         }
     }
-    sendUDPPacket(packetOut, (struct sockaddr *)&UDPFrom.addr, UDPFrom.addrlen,
-                  state.socketUDP);
+    replyUDPPacket(state, packetOut, packetOut.status, UDPFrom);
 }
 
 void LOUHandler(ServerState &state, std::string msg, Address UDPFrom) {
@@ -94,11 +182,11 @@ void LOUHandler(ServerState &state, std::string msg, Address UDPFrom) {
                    !logoutUser(packetIn.UID)) {
             packetOut.status = "NOK";
         } else {
+            state.replies.changedUsers();
             packetOut.status = "OK";
         }
     }
-    sendUDPPacket(packetOut, (struct sockaddr *)&UDPFrom.addr, UDPFrom.addrlen,
-                  state.socketUDP);
+    replyUDPPacket(state, packetOut, packetOut.status, UDPFrom);
 }
 
 void UNRHandler(ServerState &state, std::string msg, Address UDPFrom) {
@@ -118,11 +206,11 @@ void UNRHandler(ServerState &state, std::string msg, Address UDPFrom) {
                    !unregisterUser(packetIn.UID)) {
             packetOut.status = "NOK";
         } else {
+            state.replies.changedUsers();
             packetOut.status = "OK";
         }
     }
-    sendUDPPacket(packetOut, (struct sockaddr *)&UDPFrom.addr, UDPFrom.addrlen,
-                  state.socketUDP);
+    replyUDPPacket(state, packetOut, packetOut.status, UDPFrom);
 }
 
 void LMAHandler(ServerState &state, std::string msg, Address UDPFrom) {
@@ -138,16 +226,14 @@ void LMAHandler(ServerState &state, std::string msg, Address UDPFrom) {
         std::vector<Auction> auctions;
         if (!checkLoggedIn(packetIn.UID)) {
             packetOut.status = "NLG";
-        } else if (!getAuctions("USERS/" + packetIn.UID + "/HOSTED",
-                                auctions)) {
+        } else if (!getUserAuctions(packetIn.UID, HOSTED_MARK, auctions)) {
             packetOut.status = "NOK";
         } else {
             packetOut.status = "OK";
             packetOut.auctions = auctions;
         }
     }
-    sendUDPPacket(packetOut, (struct sockaddr *)&UDPFrom.addr, UDPFrom.addrlen,
-                  state.socketUDP);
+    replyUDPPacket(state, packetOut, packetOut.status, UDPFrom);
 }
 
 void LMBHandler(ServerState &state, std::string msg, Address UDPFrom) {
@@ -165,16 +251,14 @@ void LMBHandler(ServerState &state, std::string msg, Address UDPFrom) {
         std::vector<Auction> auctions;
         if (!checkLoggedIn(packetIn.UID)) {
             packetOut.status = "NLG";
-        } else if (!getAuctions("USERS/" + packetIn.UID + "/BIDDED",
-                                auctions)) {
+        } else if (!getUserAuctions(packetIn.UID, BIDDED_MARK, auctions)) {
             packetOut.status = "NOK";
         } else {
             packetOut.status = "OK";
             packetOut.auctions = auctions;
         }
     }
-    sendUDPPacket(packetOut, (struct sockaddr *)&UDPFrom.addr, UDPFrom.addrlen,
-                  state.socketUDP);
+    replyUDPPacket(state, packetOut, packetOut.status, UDPFrom);
 }
 
 void LSTHandler(ServerState &state, std::string msg, Address UDPFrom) {
@@ -188,15 +272,69 @@ void LSTHandler(ServerState &state, std::string msg, Address UDPFrom) {
                        << std::endl;
 
         std::vector<Auction> auctions;
-        if (!getAuctions("AUCTIONS", auctions)) {
+        if (!getAllAuctions(auctions)) {
             packetOut.status = "NOK";
         } else {
             packetOut.status = "OK";
             packetOut.auctions = auctions;
         }
     }
-    sendUDPPacket(packetOut, (struct sockaddr *)&UDPFrom.addr, UDPFrom.addrlen,
-                  state.socketUDP);
+    replyUDPPacket(state, packetOut, packetOut.status, UDPFrom);
+}
+
+void LPGHandler(ServerState &state, std::string msg, Address UDPFrom) {
+    LPGPacket packetIn;
+    RLPPacket packetOut;
+
+    if (packetIn.deserialize(msg)) {
+        packetOut.status = "ERR";
+    } else {
+        state.cverbose << "| A user asked to list "
+                       << (packetIn.activeOnly ? "the active" : "all of the")
+                       << " auctions after number '"
+                       << toDigits(packetIn.cursor, AID_LEN) << "', "
+                       << packetIn.pageSize << " at a time" << std::endl;
+
+        if (!getAuctionsPage(packetIn.cursor, packetIn.pageSize,
+                             packetIn.activeOnly, packetOut.auctions,
+                             packetOut.next)) {
+            packetOut.status = "NOK";
+        } else {
+            packetOut.status = "OK";
+        }
+    }
+    replyUDPPacket(state, packetOut, packetOut.status, UDPFrom);
+}
+
+void LFLHandler(ServerState &state, std::string msg, Address UDPFrom) {
+    LFLPacket packetIn;
+    RLFPacket packetOut;
+
+    if (packetIn.deserialize(msg)) {
+        packetOut.status = "ERR";
+    } else {
+        int found;
+        if (packetIn.filter == FILTER_RANGE) {
+            state.cverbose << "| A user asked to list the auctions from "
+                           << "number '" << toDigits(packetIn.from, AID_LEN)
+                           << "' to '" << toDigits(packetIn.to, AID_LEN)
+                           << "'" << std::endl;
+            found = getAuctionsRange(packetIn.from, packetIn.to,
+                                     packetOut.auctions);
+        } else if (packetIn.filter == FILTER_ENDING) {
+            state.cverbose << "| A user asked to list the auctions ending "
+                           << "within " << packetIn.within << " seconds"
+                           << std::endl;
+            found = getEndingAuctions(packetIn.within, true,
+                                      packetOut.auctions);
+        } else {
+            state.cverbose << "| A user asked to list the active auctions"
+                           << std::endl;
+            found = getEndingAuctions(0, false, packetOut.auctions);
+        }
+        packetOut.status = found ? "OK" : "NOK";
+    }
+    replyUDPPacket(state, packetOut, packetOut.status, UDPFrom);
 }
 
 void SRCHandler(ServerState &state, std::string msg, Address UDPFrom) {
@@ -217,8 +355,59 @@ void SRCHandler(ServerState &state, std::string msg, Address UDPFrom) {
             packetOut.info = info;
         }
     }
-    sendUDPPacket(packetOut, (struct sockaddr *)&UDPFrom.addr, UDPFrom.addrlen,
-                  state.socketUDP);
+    replyUDPPacket(state, packetOut, packetOut.status, UDPFrom);
+}
+
+void SRDHandler(ServerState &state, std::string msg, Address UDPFrom) {
+    SRDPacket packetIn;
+    RRDPacket packetOut;
+
+    if (packetIn.deserialize(msg)) {
+        packetOut.status = "ERR";
+    } else {
+        state.cverbose << "| A user asked for the record of auction number '"
+                       << packetIn.AID << "' after bid number " << packetIn.seq
+                       << std::endl;
+
+        bool unchanged;
+        if (!getAuctionRecordSince(packetIn.AID, packetIn.seq, packetOut.info,
+                                   unchanged)) {
+            packetOut.status = "NOK";
+        } else {
+            packetOut.status = unchanged ? "UNC" : "OK";
+        }
+    }
+    replyUDPPacket(state, packetOut, packetOut.status, UDPFrom);
+}
+
+void STAHandler(ServerState &state, std::string msg, Address UDPFrom) {
+    STAPacket packetIn;
+    RSTPacket packetOut;
+
+    if (packetIn.deserialize(msg)) {
+        packetOut.status = "ERR";
+    } else {
+        state.cverbose << "| A user asked for the server metrics" << std::endl;
+
+        // Metrics are only exported to clients on the loopback interface
+        if ((ntohl(UDPFrom.addr.sin_addr.s_addr) >> 24) != IN_LOOPBACKNET) {
+            packetOut.status = "NOK";
+        } else {
+            packetOut.status = "OK";
+            packetOut.info = state.metrics->report();
+        }
+    }
+    replyUDPPacket(state, packetOut, packetOut.status, UDPFrom);
+}
+
+static void publishOpened(ServerState &state, const std::string &AID,
+                          const std::string &UID, uint32_t startValue) {
+    EVTPacket event;
+    event.kind = EVENT_OPENED;
+    event.AID = toAID(AID);
+    event.UID = UID;
+    event.value = startValue;
+    state.events.publish(event);
 }
 
 void OPAHandler(ServerState &state, int fd) {
@@ -234,20 +423,153 @@ void OPAHandler(ServerState &state, int fd) {
                        << packetIn.startValue << "' and a maximum duration of '"
                        << packetIn.duration << "' seconds" << std::endl;
 
-        std::string newAID = getNewAID();
+        std::string newAID = getNewAID(state.maxAuctions);
         if (!checkLoggedIn(packetIn.UID) ||
             !checkLoginMatch(packetIn.UID, packetIn.password)) {
             packetOut.status = "NLG";
         } else if (!openAuction(newAID, packetIn.UID, packetIn.auctionName,
                                 packetIn.assetfName, packetIn.startValue,
-                                packetIn.duration)) {
+                                packetIn.duration, packetIn.assetfName)) {
             packetOut.status = "NOK";
         } else {
             packetOut.status = "OK";
             packetOut.AID = newAID;
         }
     }
-    packetOut.serialize(fd);
+    replyTCPPacket(state, packetOut, packetOut.status, fd);
+
+    if (packetOut.status == "OK") {
+        publishOpened(state, packetOut.AID, packetIn.UID, packetIn.startValue);
+    }
+}
+
+void UPSHandler(ServerState &state, const int fd) {
+    UPSPacket packetIn;
+    RUSPacket packetOut;
+
+    if (packetIn.deserialize(fd)) {
+        packetOut.status = "ERR";
+    } else {
+        state.cverbose << "| User with id '" << packetIn.UID
+                       << "' asked to upload an asset of "
+                       << packetIn.assetfSize << " bytes in chunks"
+                       << std::endl;
+
+        uint32_t UID;
+        toInt(packetIn.UID, UID);
+        if (!checkLoggedIn(packetIn.UID) ||
+            !checkLoginMatch(packetIn.UID, packetIn.password)) {
+            packetOut.status = "NLG";
+        } else if ((packetOut.token = state.uploads.begin(
+                        UID, packetIn.assetfSize, monotonicMillis())) == 0) {
+            packetOut.status = "NOK";
+        } else {
+            packetOut.status = "OK";
+        }
+    }
+    replyTCPPacket(state, packetOut, packetOut.status, fd);
+}
+
+// Only reads up to the data of the chunk, which the listener then reads with
+// UPCDataHandler as it arrives. A chunk sent again can overwrite bytes that
+// were already verified, so its range stops counting until its checksum
+// matches.
+void UPCHandler(ServerState &state, const int fd) {
+    Chunk chunk;
+    if (chunk.packet.deserialize(fd)) {
+        RUCPacket packetOut;
+        packetOut.status = "ERR";
+        replyTCPPacket(state, packetOut, packetOut.status, fd);
+        return;
+    }
+    UPCPacket &packetIn = chunk.packet;
+    Upload *upload = state.uploads.find(packetIn.token, monotonicMillis());
+    chunk.done = 0;
+    chunk.received = 0;
+    chunk.write =
+        upload != NULL && packetIn.offset < upload->size &&
+        packetIn.length <= upload->size - packetIn.offset &&
+        !state.uploads.overlapsChunk(packetIn.token, packetIn.offset,
+                                     packetIn.length);
+    if (chunk.write) {
+        state.uploads.forget(*upload, packetIn.offset, packetIn.length);
+    }
+    // A refused chunk is read anyway, so that the user gets the reply
+    state.uploads.startChunk(fd, chunk);
+}
+
+void UPCDataHandler(ServerState &state, const int fd) {
+    Chunk &chunk = *state.uploads.chunk(fd);
+    UPCPacket &packetIn = chunk.packet;
+    RUCPacket packetOut;
+
+    Upload *upload = NULL;
+    if (chunk.write &&
+        (upload = state.uploads.find(packetIn.token, monotonicMillis())) ==
+            NULL) {
+        chunk.write = false; // the upload was dropped meanwhile
+    }
+    if (packetIn.receiveData(fd, chunk.write ? upload->fd : -1, chunk.done,
+                             chunk.received)) {
+        packetOut.status = "ERR";
+    } else if (chunk.done < packetIn.length) {
+        return;
+    } else if (!chunk.write) {
+        packetOut.status = "NOK";
+    } else if (chunk.received != packetIn.crc) {
+        state.cwarn << CHUNK_CRC_MISMATCH(packetIn.offset) << std::endl;
+        packetOut.status = "CRC";
+    } else {
+        state.uploads.received(*upload, packetIn.offset, packetIn.length);
+        packetOut.status = "OK";
+    }
+    state.uploads.endChunk(fd);
+    replyTCPPacket(state, packetOut, packetOut.status, fd);
+}
+
+void OPCHandler(ServerState &state, const int fd) {
+    OPCPacket packetIn;
+    ROAPacket packetOut;
+
+    if (packetIn.deserialize(fd)) {
+        packetOut.status = "ERR";
+    } else {
+        state.cverbose << "| User with id '" << packetIn.UID
+                       << "' asked to create an auction with name '"
+                       << packetIn.auctionName << "', a start value of '"
+                       << packetIn.startValue << "' and a maximum duration of '"
+                       << packetIn.duration << "' seconds from an upload"
+                       << std::endl;
+
+        uint32_t UID;
+        toInt(packetIn.UID, UID);
+        Upload *upload = state.uploads.find(packetIn.token, monotonicMillis());
+        if (!checkLoggedIn(packetIn.UID) ||
+            !checkLoginMatch(packetIn.UID, packetIn.password)) {
+            packetOut.status = "NLG";
+        } else if (upload == NULL || upload->UID != UID ||
+                   !state.uploads.complete(*upload)) {
+            packetOut.status = "NOK";
+        } else {
+            std::string newAID = getNewAID(state.maxAuctions);
+            state.uploads.finish(packetIn.token);
+            if (!openAuction(newAID, packetIn.UID, packetIn.auctionName,
+                             packetIn.assetfName, packetIn.startValue,
+                             packetIn.duration,
+                             UploadTable::stagingPath(packetIn.token))) {
+                unlink(UploadTable::stagingPath(packetIn.token).c_str());
+                packetOut.status = "NOK";
+            } else {
+                packetOut.status = "OK";
+                packetOut.AID = newAID;
+            }
+        }
+    }
+    replyTCPPacket(state, packetOut, packetOut.status, fd);
+
+    if (packetOut.status == "OK") {
+        publishOpened(state, packetOut.AID, packetIn.UID, packetIn.startValue);
+    }
 }
 
 void CLSHandler(ServerState &state, const int fd) {
@@ -274,7 +596,14 @@ void CLSHandler(ServerState &state, const int fd) {
             packetOut.status = "OK";
         }
     }
-    packetOut.serialize(fd);
+    replyTCPPacket(state, packetOut, packetOut.status, fd);
+
+    if (packetOut.status == "OK") {
+        EVTPacket event;
+        event.kind = EVENT_CLOSED;
+        event.AID = toAID(packetIn.AID);
+        state.events.publish(event);
+    }
 }
 
 void BIDHandler(ServerState &state, const int fd) {
@@ -304,7 +633,16 @@ void BIDHandler(ServerState &state, const int fd) {
             packetOut.status = "ACC";
         }
     }
-    packetOut.serialize(fd);
+    replyTCPPacket(state, packetOut, packetOut.status, fd);
+
+    if (packetOut.status == "ACC") {
+        EVTPacket event;
+        event.kind = EVENT_BID;
+        event.AID = toAID(packetIn.AID);
+        event.UID = packetIn.UID;
+        event.value = packetIn.value;
+        state.events.publish(event);
+    }
 }
 
 void SASHandler(ServerState &state, const int fd) {
@@ -325,5 +663,54 @@ void SASHandler(ServerState &state, const int fd) {
             packetOut.assetfPath = fPath;
         }
     }
-    packetOut.serialize(fd);
+    replyTCPPacket(state, packetOut, packetOut.status, fd);
+}
+
+void SARHandler(ServerState &state, const int fd) {
+    SARPacket packetIn;
+    RSRPacket packetOut;
+
+    if (packetIn.deserialize(fd)) {
+        packetOut.status = "ERR";
+    } else {
+        state.cverbose << "| A User asked for the asset of auction number '"
+                       << packetIn.AID << "' from byte " << packetIn.offset
+                       << std::endl;
+
+        std::string fPath;
+        if (!getAuctionAsset(packetIn.AID, fPath)) {
+            packetOut.status = "NOK";
+        } else {
+            packetOut.status = "OK";
+            packetOut.assetfPath = fPath;
+            packetOut.offset = packetIn.offset;
+            packetOut.length = packetIn.length;
+        }
+    }
+    replyTCPPacket(state, packetOut, packetOut.status, fd);
+}
+
+void SUBHandler(ServerState &state, const int fd) {
+    SUBPacket packetIn;
+    RSBPacket packetOut;
+
+    if (packetIn.deserialize(fd)) {
+        packetOut.status = "ERR";
+    } else {
+        state.cverbose << "| A user subscribed to the events of "
+                       << (packetIn.AID == "000"
+                               ? "every auction"
+                               : "auction number '" + packetIn.AID + "'")
+                       << std::endl;
+
+        // The listener keeps the connection open once it's subscribed
+        if (packetIn.AID != "000" && !checkAuctionExists(packetIn.AID)) {
+            packetOut.status = "NOK";
+        } else if (!state.events.subscribe(fd, toAID(packetIn.AID))) {
+            packetOut.status = "ERR";
+        } else {
+            packetOut.status = "OK";
+        }
+    }
+    replyTCPPacket(state, packetOut, packetOut.status, fd);
 }
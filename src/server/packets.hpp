@@ -1,6 +1,7 @@
 #ifndef __PACKETS_HPP__
 #define __PACKETS_HPP__
 
+#include "../lib/protocol.hpp"
 #include "../lib/utils.hpp"
 #include "server_state.hpp"
 
@@ -15,6 +16,18 @@ typedef std::map<std::string, std::function<void(ServerState &, const int)>>
 
 void interpretUDPPacket(ServerState &state, std::string msg, Address UDPFrom);
 void interpretTCPPacket(ServerState &state, const int fd);
+void shedUDPPacket(ServerState &state, const std::string &packetID,
+                   Address &UDPFrom);
+void shedTCPPacket(ServerState &state, const std::string &packetID,
+                   const int fd);
+void replyUDPPacket(ServerState &state, UDPPacket &packet,
+                    const std::string &status, Address &UDPTo);
+void replyTCPPacket(ServerState &state, TCPPacket &packet,
+                    const std::string &status, const int fd);
+// Ends the writes after a refusal and reads what the user sent for a moment,
+// since closing with data unread resets the connection and the user may lose
+// the reply
+void drainTCPSocket(const int fd);
 
 // UDP
 void LINHandler(ServerState &state, std::string msg, Address UDPFrom);
@@ -23,12 +36,24 @@ void UNRHandler(ServerState &state, std::string msg, Address UDPFrom);
 void LMAHandler(ServerState &state, std::string msg, Address UDPFrom);
 void LMBHandler(ServerState &state, std::string msg, Address UDPFrom);
 void LSTHandler(ServerState &state, std::string msg, Address UDPFrom);
+void LPGHandler(ServerState &state, std::string msg, Address UDPFrom);
+void LFLHandler(ServerState &state, std::string msg, Address UDPFrom);
 void SRCHandler(ServerState &state, std::string msg, Address UDPFrom);
+void SRDHandler(ServerState &state, std::string msg, Address UDPFrom);
+void STAHandler(ServerState &state, std::string msg, Address UDPFrom);
 
 // TCP
 void OPAHandler(ServerState &state, const int fd);
+void UPSHandler(ServerState &state, const int fd);
+void UPCHandler(ServerState &state, const int fd);
+// Reads what arrived of the data of the chunk on the connection, and replies
+// once all of it is in
+void UPCDataHandler(ServerState &state, const int fd);
+void OPCHandler(ServerState &state, const int fd);
 void CLSHandler(ServerState &state, const int fd);
 void BIDHandler(ServerState &state, const int fd);
 void SASHandler(ServerState &state, const int fd);
+void SARHandler(ServerState &state, const int fd);
+void SUBHandler(ServerState &state, const int fd);
 
 #endif // __PACKETS_HPP__
@@ -2,11 +2,96 @@
 #include "../lib/constants.hpp"
 #include "../lib/messages.hpp"
 #include "../lib/utils.hpp"
+#include "clock.hpp"
+#include "table.hpp"
 
 #include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <fcntl.h>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <string_view>
+#include <sys/stat.h>
+#include <thread>
+
+std::string auctionPath(const std::string &AID) {
+    return "AUCTIONS/" + AID.substr(0, AID.length() - AUCTION_SHARD_DIGITS) +
+           "/" + AID;
+}
+
+uint32_t toAID(const std::string &AID) {
+    uint32_t num;
+    return toInt(AID, num) ? 0 : num;
+}
+
+static std::string fromAID(uint32_t AID) { return toDigits(AID, AID_LEN); }
+
+static std::string userIndexPath(const std::string &UID) {
+    return "USERS/" + UID + "/auctions.txt";
+}
+
+static int writeAll(const int fd, const std::string &content) {
+    const char *ptr = content.c_str();
+    size_t left = content.length();
+    while (left > 0) {
+        ssize_t n = write(fd, ptr, left);
+        if (n <= 0) {
+            return 0;
+        }
+        ptr += n;
+        left -= (size_t)n;
+    }
+    return 1;
+}
+
+// Flushes a file, or the entries of a directory, to the disk
+static int syncPath(const std::string &path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd == -1) {
+        return 0;
+    }
+    int res = fsync(fd) == 0;
+    close(fd);
+    return res;
+}
+
+static int writeFile(const std::string &path, const std::string &content,
+                     bool sync) {
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1) {
+        return 0;
+    }
+    int res = writeAll(fd, content) && (!sync || fdatasync(fd) == 0);
+    return close(fd) == 0 && res;
+}
+
+// A crash leaves either the old or the new content, never a mix of both. It
+// only survives a power loss with sync, otherwise it must be derivable.
+static int replaceFile(const std::string &path, const std::string &content,
+                       bool sync) {
+    std::string tmpPath = path + ".tmp";
+    if (!writeFile(tmpPath, content, sync) ||
+        rename(tmpPath.c_str(), path.c_str()) != 0) {
+        unlink(tmpPath.c_str());
+        return 0;
+    }
+    return 1;
+}
+
+// Appends a whole line, which is on the disk once this returns
+static int appendLine(const std::string &path, const std::string &line) {
+    int fd = open(path.c_str(), O_WRONLY | O_APPEND);
+    if (fd == -1) {
+        return 0;
+    }
+    int res = writeAll(fd, line) && fdatasync(fd) == 0;
+    return close(fd) == 0 && res;
+}
 
 int checkRegister(const std::string UID) {
     return std::filesystem::exists("USERS/" + UID) &&
@@ -40,11 +125,6 @@ int registerUser(std::string UID, std::string password) {
         if (!std::filesystem::create_directory(userDir)) {
             return 0;
         }
-        if (!std::filesystem::create_directory(userDir + "/HOSTED") ||
-            !std::filesystem::create_directory(userDir + "/BIDDED")) {
-            std::filesystem::remove_all(userDir);
-            return 0;
-        }
     }
 
     std::string passPath = userDir + "/password.txt";
@@ -78,248 +158,762 @@ int unregisterUser(std::string UID) {
 }
 
 int getAuctionTime(std::string AID, uint32_t &fullTime, uint32_t &duration) {
-    std::ifstream timeFile("AUCTIONS/" + AID + "/time.txt");
-    if (!timeFile.is_open()) {
-        return 0;
-    }
-    std::string strFullTime, strDuration;
-    std::getline(timeFile, strFullTime);
-    std::getline(timeFile, strDuration);
-    if (toInt(strFullTime, fullTime) || toInt(strDuration, duration)) {
+    AuctionInfo info;
+    if (!auctionTable->read(toAID(AID), info)) {
         return 0;
     }
-    timeFile.close();
+    fullTime = (uint32_t)info.startTime;
+    duration = info.duration;
     return 1;
 }
 
 int checkAuctionExpiration(std::string AID, time_t &currentTime) {
-    if (std::filesystem::exists("AUCTIONS/" + AID + "/end.txt")) {
-        return 0;
-    }
-
-    uint32_t fullTime, duration;
-    if (!getAuctionTime(AID, fullTime, duration)) {
+    AuctionInfo info;
+    if (!auctionTable->read(toAID(AID), info) || info.endTime != 0) {
         return 0;
     }
 
-    currentTime = time(NULL);
-    if ((uint32_t)currentTime - fullTime >= duration) {
-        std::ofstream endFile("AUCTIONS/" + AID + "/end.txt");
-        if (!endFile.is_open()) {
-            return 0;
+    currentTime = serverClock.now();
+    if (!isActive(info, currentTime)) {
+        // Not synced, it is written again if lost
+        std::string endPath = auctionPath(AID) + "/end.txt";
+        if (!std::filesystem::exists(endPath)) {
+            replaceFile(endPath,
+                        toDate(info.startTime + info.duration) + " " +
+                            std::to_string(info.duration) + "\n",
+                        false);
         }
-        endFile << toDate(fullTime + duration) << " " << duration << std::endl;
-        endFile.close();
         return 0;
     }
     return 1;
 }
 
 uint8_t getAuctionState(std::string AID) {
-    time_t t; // not used
-    return (uint8_t)checkAuctionExpiration(AID, t);
+    AuctionInfo info;
+    return auctionTable->read(toAID(AID), info) &&
+           isActive(info, serverClock.now());
 }
 
-int getAuctions(std::string path, std::vector<Auction> &auctions) {
-    const std::filesystem::path auctionsPath(path);
+// Sorted names of the entries of a directory
+static std::vector<std::string> listDirectory(const std::string &path) {
+    std::vector<std::string> names;
+    for (auto const &entry : std::filesystem::directory_iterator(path)) {
+        names.push_back(entry.path().filename());
+    }
+    std::sort(names.begin(), names.end());
+    return names;
+}
 
-    std::vector<std::filesystem::path> entries;
-    std::copy(std::filesystem::directory_iterator(auctionsPath),
-              std::filesystem::directory_iterator(),
-              std::back_inserter(entries));
-    std::sort(entries.begin(), entries.end());
-    for (auto const &entry : entries) {
-        std::string AID = entry.filename();
-        uint8_t state = getAuctionState(AID);
-        auctions.push_back({AID, state});
+static int isShard(const std::string &name) {
+    return name.length() == AID_LEN - AUCTION_SHARD_DIGITS &&
+           std::all_of(name.begin(), name.end(), ::isdigit);
+}
+
+int getAllAuctions(std::vector<Auction> &auctions) {
+    uint64_t active[ACTIVE_BITMAP_WORDS];
+    uint32_t count = auctionTable->sweepActive(serverClock.now(), active);
+    for (uint32_t i = 0; i < count; ++i) {
+        if (auctionTable->flags[i] & SLOT_IN_USE) {
+            uint8_t state = (uint8_t)(active[i / 64] >> (i % 64) & 1);
+            auctions.push_back({i + 1, state});
+        }
+    }
+    return !auctions.empty();
+}
+
+// The slots after the cursor are swept 64 at a time, so a page of active
+// auctions costs one sweep per 64 inactive ones skipped
+int getAuctionsPage(uint32_t cursor, uint32_t pageSize, bool activeOnly,
+                    std::vector<Auction> &auctions, uint32_t &next) {
+    uint32_t count = auctionTable->count.load(std::memory_order_acquire);
+    uint32_t now = (uint32_t)serverClock.now();
+    uint32_t i = std::min(cursor, count); // slot of the AID after the cursor
+    while (i < count && auctions.size() < pageSize) {
+        uint32_t len = std::min(count - i, 64U);
+        uint64_t active;
+        sweepActive(auctionTable->startTimes + i, auctionTable->durations + i,
+                    auctionTable->flags + i, len, now, &active);
+        for (uint32_t j = 0; j < len && auctions.size() < pageSize; ++i, ++j) {
+            uint8_t state = (uint8_t)(active >> j & 1);
+            if ((auctionTable->flags[i] & SLOT_IN_USE) &&
+                (state || !activeOnly)) {
+                auctions.push_back({i + 1, state});
+            }
+        }
+    }
+    next = i < count ? i : 0;
+    return !auctions.empty();
+}
+
+// Read from the index of the auctions by end time, so the closed and expired
+// ones are never looked at
+int getEndingAuctions(uint32_t within, bool byEndTime,
+                      std::vector<Auction> &auctions) {
+    uint32_t now = (uint32_t)serverClock.now();
+    std::vector<uint32_t> AIDs;
+    auctionTable->endIndex.endingBetween(
+        now, within == 0 ? UINT32_MAX : now + within, AIDs);
+    if (!byEndTime) {
+        std::sort(AIDs.begin(), AIDs.end());
+    }
+    for (uint32_t AID : AIDs) {
+        auctions.push_back({AID, 1});
+    }
+    return !auctions.empty();
+}
+
+int getAuctionsRange(uint32_t from, uint32_t to,
+                     std::vector<Auction> &auctions) {
+    uint32_t count = auctionTable->count.load(std::memory_order_acquire);
+    uint32_t now = (uint32_t)serverClock.now();
+    for (uint32_t i = from - 1; i < std::min(to, count); i += 64) {
+        uint32_t len = std::min(std::min(to, count) - i, 64U);
+        uint64_t active;
+        sweepActive(auctionTable->startTimes + i, auctionTable->durations + i,
+                    auctionTable->flags + i, len, now, &active);
+        for (uint32_t j = 0; j < len; ++j) {
+            if (auctionTable->flags[i + j] & SLOT_IN_USE) {
+                auctions.push_back({i + j + 1, (uint8_t)(active >> j & 1)});
+            }
+        }
+    }
+    return !auctions.empty();
+}
+
+int getUserAuctions(std::string UID, char mark,
+                    std::vector<Auction> &auctions) {
+    std::ifstream indexFile(userIndexPath(UID));
+    std::vector<uint32_t> AIDs;
+    std::string line;
+    while (std::getline(indexFile, line)) {
+        if (line.length() == AID_LEN + 2 && line.at(0) == mark) {
+            AIDs.push_back(toAID(line.substr(2)));
+        }
+    }
+    std::sort(AIDs.begin(), AIDs.end());
+    AIDs.erase(std::unique(AIDs.begin(), AIDs.end()), AIDs.end());
+    time_t now = serverClock.now();
+    for (uint32_t AID : AIDs) {
+        AuctionInfo info;
+        if (auctionTable->read(AID, info)) {
+            auctions.push_back({AID, isActive(info, now)});
+        }
     }
     return !auctions.empty();
 }
 
+// Appends "<mark> <AID>" to the index of the user
+static int appendUserAuction(const std::string &UID, const std::string &entry) {
+    std::ofstream indexOut(userIndexPath(UID), std::ios::app);
+    if (!indexOut.is_open()) {
+        return 0;
+    }
+    indexOut << entry << std::endl;
+    indexOut.close();
+    return 1;
+}
+
+// Appends "<mark> <AID>" to the index of the user, unless it's already there
+int addUserAuction(std::string UID, std::string AID, char mark) {
+    std::string entry = std::string(1, mark) + " " + AID;
+    std::string line;
+    std::ifstream indexIn(userIndexPath(UID));
+    while (std::getline(indexIn, line)) {
+        if (line == entry) {
+            return 1;
+        }
+    }
+    indexIn.close();
+    return appendUserAuction(UID, entry);
+}
+
+// Whether the auction is already in the index of the bidder, as far as the
+// last bids in the table tell
+static bool bidInRing(const AuctionInfo &info, const BidRing &bids,
+                      uint32_t bidderUID) {
+    uint32_t n = std::min(info.numBids, (uint32_t)MAX_BIDS_LISTINGS);
+    for (uint32_t i = 0; i < n; ++i) {
+        if (bids[i].bidderUID == bidderUID) {
+            return true;
+        }
+    }
+    return false;
+}
+
 int closeAuction(std::string AID) {
     time_t currentTime;
     if (!checkAuctionExpiration(AID, currentTime)) {
         return 0;
     }
 
-    std::ofstream endFile("AUCTIONS/" + AID + "/end.txt");
-    if (!endFile.is_open()) {
-        return 0;
-    }
-    uint32_t fullTime, duration;
-    if (!getAuctionTime(AID, fullTime, duration)) {
+    AuctionInfo info;
+    if (!auctionTable->read(toAID(AID), info) ||
+        !replaceFile(auctionPath(AID) + "/end.txt",
+                     serverClock.date() + " " +
+                         std::to_string(currentTime - info.startTime) + "\n",
+                     true) ||
+        !syncPath(auctionPath(AID))) {
         return 0;
     }
-    endFile << toDate(currentTime) << " " << (uint32_t)currentTime - fullTime
-            << std::endl;
-    endFile.close();
+    info.endTime = currentTime;
+    auctionTable->write(toAID(AID), info);
     return 1;
 }
 
 int checkAuctionExists(std::string AID) {
-    return std::filesystem::exists("AUCTIONS/" + AID);
+    AuctionInfo info;
+    return auctionTable->read(toAID(AID), info);
 }
 
 int checkUserHostedAuction(std::string UID, std::string AID) {
-    return std::filesystem::exists("USERS/" + UID + "/HOSTED/" + AID);
+    AuctionInfo info;
+    uint32_t hostUID;
+    return auctionTable->read(toAID(AID), info) && !toInt(UID, hostUID) &&
+           hostUID == info.hostUID;
 }
 
-std::string getNewAID() {
-    ssize_t count =
-        std::distance(std::filesystem::directory_iterator("AUCTIONS"),
-                      std::filesystem::directory_iterator{});
-    if (count >= MAX_AUCTIONS) {
+// AIDs are given out in order
+std::string getNewAID(uint32_t maxAuctions) {
+    uint32_t last = auctionTable->count.load(std::memory_order_acquire);
+    if (last >= maxAuctions) {
         return "";
     }
-
-    std::stringstream ss;
-    ss << std::setfill('0') << std::setw(AID_LEN) << count + 1;
-    return ss.str();
+    return fromAID(last + 1);
 }
 
 int openAuction(std::string newAID, std::string UID, std::string auctionName,
-                std::string assetfName, uint32_t startValue,
-                uint32_t duration) {
+                std::string assetfName, uint32_t startValue, uint32_t duration,
+                const std::string &assetPath) {
     if (newAID.empty()) {
         return 0; // reached the maximum number of auctions
     }
 
-    time_t startTime = time(NULL);
-    std::string auctionDir = "AUCTIONS/" + newAID;
-    if (!std::filesystem::create_directory(auctionDir)) {
+    // The auction is built under a hidden name and renamed into place once
+    // start.txt and the asset are on the disk. The other files are derivable,
+    // so loadAuctions rebuilds them if a crash loses them.
+    std::string auctionDir = auctionPath(newAID);
+    std::string shardDir = std::filesystem::path(auctionDir).parent_path();
+    std::string stageDir = shardDir + "/." + newAID;
+    std::string stagedAsset = stageDir + "/ASSET/" + assetfName;
+    std::filesystem::create_directory(shardDir);
+    std::filesystem::remove_all(stageDir); // left by a failed open
+    if (!std::filesystem::create_directory(stageDir) ||
+        !std::filesystem::create_directory(stageDir + "/ASSET") ||
+        !std::filesystem::create_directory(stageDir + "/BIDS")) {
+        std::filesystem::remove_all(stageDir);
         return 0;
     }
-    if (!std::filesystem::create_directory(auctionDir + "/ASSET") ||
-        !std::filesystem::create_directory(auctionDir + "/BIDS")) {
-        std::filesystem::remove_all(auctionDir);
+    try {
+        std::filesystem::rename(assetPath, stagedAsset);
+    } catch (std::filesystem::filesystem_error &e) {
+        std::filesystem::remove_all(stageDir);
         return 0;
     }
-    std::ofstream startFile(auctionDir + "/start.txt");
-    std::ofstream timeFile(auctionDir + "/time.txt");
-    std::ofstream nameFile(auctionDir + "/ASSET/name.txt");
-    std::ofstream highestBidFile(auctionDir + "/BIDS/highest.txt");
-    std::ofstream bidsFile(auctionDir + "/BIDS/list.txt");
-    std::ofstream hostFile("USERS/" + UID + "/HOSTED/" + newAID);
-    if (!startFile.is_open() || !timeFile.is_open() || !nameFile ||
-        !highestBidFile.is_open() || !bidsFile.is_open() ||
-        !hostFile.is_open()) {
-        std::filesystem::remove_all(auctionDir);
+
+    std::string start = UID + " " + auctionName + " " + assetfName + " " +
+                        std::to_string(startValue) + " " + serverClock.date() +
+                        " " + std::to_string(duration) + "\n";
+    if (!writeFile(stageDir + "/ASSET/name.txt", assetfName + "\n", false) ||
+        !writeFile(stageDir + "/time.txt",
+                   std::to_string(serverClock.now()) + "\n" +
+                       std::to_string(duration) + "\n",
+                   false) ||
+        !writeFile(stageDir + "/BIDS/highest.txt",
+                   std::to_string(startValue) + "\n", false) ||
+        !writeFile(stageDir + "/BIDS/list.txt", "", false) ||
+        !syncPath(stagedAsset) ||
+        !writeFile(stageDir + "/start.txt", start, true) ||
+        rename(stageDir.c_str(), auctionDir.c_str()) != 0) {
+        std::filesystem::remove_all(stageDir);
         return 0;
     }
-    bidsFile.close();
-    hostFile.close();
-    try {
-        std::filesystem::rename(assetfName,
-                                auctionDir + "/ASSET/" + assetfName);
-    } catch (std::filesystem::filesystem_error &e) {
-        std::filesystem::remove_all(auctionDir);
-        return 0;
+    syncPath(shardDir);
+
+    // Indexed before it is in the table, so that a snapshot taken in between
+    // can't hold an auction its host doesn't know about
+    int res = addUserAuction(UID, newAID, HOSTED_MARK);
+    AuctionInfo info;
+    memset(&info, 0, sizeof(info));
+    toInt(UID, info.hostUID);
+    strncpy(info.name, auctionName.c_str(), MAX_AUCTION_NAME_LEN);
+    strncpy(info.assetfName, assetfName.c_str(), MAX_FILE_NAME_LEN);
+    info.startValue = startValue;
+    info.startTime = serverClock.now();
+    info.duration = duration;
+    info.highest = startValue;
+    auctionTable->write(toAID(newAID), info);
+    return res;
+}
+
+// Appends " B ..." for the bids after the first seen ones that are still in
+// the ring, and " E ..." if the auction ended
+static void appendRecordTail(std::string &info, const AuctionInfo &auction,
+                             const BidRing &bids, uint32_t seen) {
+    char date[DATE_LEN];
+    uint32_t first = seen;
+    if (auction.numBids - first > MAX_BIDS_LISTINGS) {
+        first = auction.numBids - MAX_BIDS_LISTINGS;
+    }
+    for (uint32_t i = first; i < auction.numBids; ++i) {
+        const BidInfo &bid = bids[i % MAX_BIDS_LISTINGS];
+        info += " B " + toDigits(bid.bidderUID, UID_LEN) + " ";
+        appendInt(info, bid.value);
+        formatDate(auction.startTime + bid.secTime, date);
+        info += ' ';
+        info.append(date, DATE_LEN);
+        info += ' ';
+        appendInt(info, bid.secTime);
+    }
+
+    time_t endTime = auction.endTime;
+    if (endTime == 0 && !isActive(auction, serverClock.now())) {
+        endTime = auction.startTime + auction.duration;
+    }
+    if (endTime != 0) {
+        formatDate(endTime, date);
+        info += " E ";
+        info.append(date, DATE_LEN);
+        info += ' ';
+        appendInt(info, (uint64_t)(endTime - auction.startTime));
     }
+}
 
-    nameFile << assetfName << std::endl;
-    nameFile.close();
-    highestBidFile << startValue << std::endl;
-    highestBidFile.close();
-    timeFile << startTime << std::endl << duration << std::endl;
-    timeFile.close();
-    startFile << UID << " " << auctionName << " " << assetfName << " "
-              << startValue << " " << toDate(startTime) << " " << duration
-              << std::endl;
-    startFile.close();
+int getAuctionRecord(std::string AID, std::string &info) {
+    AuctionInfo auction;
+    BidRing bids;
+    if (!auctionTable->read(toAID(AID), auction, bids)) {
+        return 0;
+    }
 
+    char date[DATE_LEN];
+    info = toDigits(auction.hostUID, UID_LEN) + " " + auction.name + " " +
+           auction.assetfName + " ";
+    appendInt(info, auction.startValue);
+    formatDate(auction.startTime, date);
+    info += ' ';
+    info.append(date, DATE_LEN);
+    info += ' ';
+    appendInt(info, auction.duration);
+    appendRecordTail(info, auction, bids, 0);
     return 1;
 }
 
-int getAuctionRecord(std::string AID, std::string &info) {
-    if (!checkAuctionExists(AID)) {
+// A seq over the number of bids (of a user that saw another server) is
+// answered as if no bid was seen
+int getAuctionRecordSince(std::string AID, uint32_t seq, std::string &info,
+                          bool &unchanged) {
+    AuctionInfo auction;
+    BidRing bids;
+    if (!auctionTable->read(toAID(AID), auction, bids)) {
         return 0;
     }
+    unchanged = seq == auction.numBids && isActive(auction, serverClock.now());
+    if (unchanged) {
+        return 1;
+    }
 
-    std::ifstream startFile("AUCTIONS/" + AID + "/start.txt");
-    std::ifstream bidsFile("AUCTIONS/" + AID + "/BIDS/list.txt");
-    if (!startFile.is_open() || !bidsFile.is_open()) {
+    info.clear();
+    appendInt(info, auction.numBids);
+    appendRecordTail(info, auction, bids, seq <= auction.numBids ? seq : 0);
+    return 1;
+}
+
+int bidAuction(std::string AID, std::string UID, uint32_t value,
+               time_t currentTime) {
+    AuctionInfo info;
+    BidRing bids;
+    if (!auctionTable->read(toAID(AID), info, bids) || value <= info.highest) {
         return 0;
     }
-    std::getline(startFile, info);
-    startFile.close();
 
-    std::string bidInfo;
-    std::vector<std::string> lines;
-    while (std::getline(bidsFile, bidInfo)) {
-        lines.push_back(bidInfo);
+    // list.txt is the journal of the bids: the bid is taken once its line is
+    // on the disk, and highest.txt is rebuilt from it if a crash loses it
+    std::string line = UID + " ";
+    appendInt(line, value);
+    line += " " + serverClock.date() + " ";
+    appendInt(line, (uint64_t)(currentTime - info.startTime));
+    line += "\n";
+    if (!appendLine(auctionPath(AID) + "/BIDS/list.txt", line) ||
+        !replaceFile(auctionPath(AID) + "/BIDS/highest.txt",
+                     std::to_string(value) + "\n", false)) {
+        return 0;
     }
-    bidsFile.close();
-    size_t numBids = lines.size();
-    size_t i = 0;
-    if (numBids > MAX_BIDS_LISTINGS) {
-        i = numBids - MAX_BIDS_LISTINGS;
+    // While every bid is in the ring it tells whether the user already bid on
+    // the auction, the index is only scanned once the earlier ones may have
+    // left it. A missing entry is added back on the next start anyway.
+    BidInfo bid;
+    toInt(UID, bid.bidderUID);
+    int res = 1;
+    if (!bidInRing(info, bids, bid.bidderUID)) {
+        res = info.numBids > MAX_BIDS_LISTINGS
+                  ? addUserAuction(UID, AID, BIDDED_MARK)
+                  : appendUserAuction(UID, std::string(1, BIDDED_MARK) + " " +
+                                               AID);
+    }
+    bid.value = value;
+    bid.secTime = (uint32_t)(currentTime - info.startTime);
+    pushBid(info, bids, bid);
+    info.journalSize += (uint32_t)line.length();
+    auctionTable->write(toAID(AID), info, bids);
+    return res;
+}
+
+int getAuctionAsset(std::string AID, std::string &fPath) {
+    AuctionInfo info;
+    if (!auctionTable->read(toAID(AID), info)) {
+        return 0;
     }
-    for (; i < numBids; ++i) {
-        info += " B " + lines.at(i);
+    fPath = auctionPath(AID) + "/ASSET/" + info.assetfName;
+    return 1;
+}
+
+// Moves the auctions into their shards and the HOSTED and BIDDED marker files
+// of each user into its index. Every step can be redone, so an interrupted
+// migration is finished on the next start.
+int migrateStorage() {
+    std::ifstream layoutIn(LAYOUT_FILE);
+    uint32_t version = 0;
+    std::string line;
+    if (std::getline(layoutIn, line) && !toInt(line, version) &&
+        version == STORAGE_LAYOUT_VERSION) {
+        return 1;
     }
+    layoutIn.close();
 
-    if (!getAuctionState(AID)) {
-        std::ifstream endFile("AUCTIONS/" + AID + "/end.txt");
-        if (!endFile.is_open()) {
-            return 0;
+    size_t numAuctions = 0, numUsers = 0;
+    try {
+        for (const std::string &AID : listDirectory("AUCTIONS")) {
+            if (AID.length() != AID_LEN) {
+                continue; // already a shard
+            }
+            std::string newPath = auctionPath(AID);
+            std::filesystem::create_directory(
+                std::filesystem::path(newPath).parent_path());
+            std::filesystem::rename("AUCTIONS/" + AID, newPath);
+            ++numAuctions;
         }
-        std::string endInfo;
-        std::getline(endFile, endInfo);
-        info += " E " + endInfo;
-        endFile.close();
+
+        const std::pair<const char *, char> markerDirs[] = {
+            {"/HOSTED", HOSTED_MARK}, {"/BIDDED", BIDDED_MARK}};
+        for (const std::string &UID : listDirectory("USERS")) {
+            bool migrated = false;
+            for (auto const &[dir, mark] : markerDirs) {
+                std::string path = "USERS/" + UID + dir;
+                if (!std::filesystem::is_directory(path)) {
+                    continue;
+                }
+                for (const std::string &AID : listDirectory(path)) {
+                    if (!addUserAuction(UID, AID, mark)) {
+                        return 0;
+                    }
+                }
+                std::filesystem::remove_all(path);
+                migrated = true;
+            }
+            numUsers += migrated;
+        }
+    } catch (std::filesystem::filesystem_error &e) {
+        std::cerr << MIGRATION_ERR << e.what() << std::endl;
+        return 0;
     }
 
+    std::ofstream layoutOut(LAYOUT_FILE);
+    if (!layoutOut.is_open()) {
+        return 0;
+    }
+    layoutOut << STORAGE_LAYOUT_VERSION << std::endl;
+    layoutOut.close();
+    if (numAuctions > 0 || numUsers > 0) {
+        std::cout << MIGRATION_DONE(numAuctions, numUsers) << std::endl;
+    }
     return 1;
 }
 
-int bidAuction(std::string AID, std::string UID, uint32_t value,
-               time_t currentTime) {
-    std::ifstream highestFile("AUCTIONS/" + AID + "/BIDS/highest.txt");
-    if (!highestFile.is_open()) {
+// Reads a whole file, with a single read for the small ones
+static int readWholeFile(const std::string &path, std::string &content) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd == -1) {
         return 0;
     }
-    std::string strHighestValue;
-    uint32_t highestValue;
-    std::getline(highestFile, strHighestValue);
-    if (toInt(strHighestValue, highestValue)) {
-        return 0;
+    char buffer[FILE_BUFFER_SIZE];
+    ssize_t n;
+    content.clear();
+    while ((n = read(fd, buffer, sizeof(buffer))) > 0) {
+        content.append(buffer, (size_t)n);
     }
-    highestFile.close();
-    if (value <= highestValue) {
-        return 0;
+    close(fd);
+    return n == 0;
+}
+
+// Splits off the next space separated token of a line
+static std::string_view nextToken(std::string_view &line) {
+    size_t start = std::min(line.find_first_not_of(' '), line.length());
+    size_t end = std::min(line.find(' ', start), line.length());
+    std::string_view token = line.substr(start, end - start);
+    line.remove_prefix(end);
+    return token;
+}
+
+// Sets the end time of an auction from its end.txt, if it has ended
+static void readEndTime(const std::string &dir, AuctionInfo &info) {
+    std::string content;
+    if (readWholeFile(dir + "/end.txt", content)) {
+        std::string_view line(content);
+        line = line.substr(0, line.find('\n'));
+        nextToken(line); // the date and time it ended
+        nextToken(line);
+        uint32_t elapsed;
+        if (!toInt(nextToken(line), elapsed)) {
+            info.endTime = info.startTime + elapsed;
+        }
     }
+}
 
-    std::ofstream highFile("AUCTIONS/" + AID + "/BIDS/highest.txt");
-    std::ofstream bidsFile("AUCTIONS/" + AID + "/BIDS/list.txt", std::ios::app);
-    if (!highFile.is_open() || !bidsFile.is_open()) {
-        return 0;
+// Auctions to add to the index of their users, as "<UID><mark> <AID>"
+typedef std::vector<std::string> IndexEntries;
+
+// Loads an auction into the table, rebuilding its derivable files from
+// start.txt and the bids journal. Returns -1 if the auction was never fully
+// opened, 1 if something had to be repaired and 0 otherwise.
+static int loadAuction(const std::string &AID, IndexEntries &entries) {
+    std::string dir = auctionPath(AID), start, journal, content;
+    std::string_view line;
+    if (toAID(AID) == 0 || toAID(AID) > MAX_AUCTIONS ||
+        !readWholeFile(dir + "/start.txt", start)) {
+        return -1;
+    }
+    line = std::string_view(start).substr(0, start.find('\n'));
+    std::string_view UID = nextToken(line), name = nextToken(line),
+                     assetfName = nextToken(line);
+    uint32_t hostUID, startValue, duration;
+    int validValue = !toInt(nextToken(line), startValue);
+    std::string date(nextToken(line));
+    date += " " + std::string(nextToken(line));
+    time_t startTime;
+    if (!validValue || parseDate(date, startTime) ||
+        toInt(nextToken(line), duration) || UID.length() != UID_LEN ||
+        toInt(UID, hostUID) || name.empty() ||
+        name.length() > MAX_AUCTION_NAME_LEN ||
+        assetfName.length() > MAX_FILE_NAME_LEN ||
+        !std::filesystem::exists(dir + "/ASSET/" + std::string(assetfName))) {
+        return -1;
+    }
+
+    int repaired = 0;
+    std::filesystem::create_directory(dir + "/BIDS");
+    int hasJournal = readWholeFile(dir + "/BIDS/list.txt", journal);
+    if (!journal.empty() && journal.back() != '\n') {
+        journal.erase(journal.find_last_of('\n') + 1); // torn last bid
+        hasJournal = 0;
+    }
+    if (!hasJournal) {
+        replaceFile(dir + "/BIDS/list.txt", journal, true);
+        repaired = 1;
+    }
+
+    AuctionInfo info;
+    BidRing bids;
+    memset(&info, 0, sizeof(info));
+    memset(bids, 0, sizeof(bids));
+    info.hostUID = hostUID;
+    memcpy(info.name, name.data(), name.length());
+    memcpy(info.assetfName, assetfName.data(), assetfName.length());
+    info.startValue = startValue;
+    info.startTime = startTime;
+    info.duration = duration;
+    info.highest = startValue;
+    info.journalSize = (uint32_t)journal.length();
+    entries.push_back(std::string(UID) + HOSTED_MARK + " " + AID);
+    std::string_view lines(journal);
+    while (!lines.empty()) {
+        line = lines.substr(0, lines.find('\n'));
+        lines.remove_prefix(std::min(line.length() + 1, lines.length()));
+        std::string_view bidderUID = nextToken(line);
+        BidInfo bid;
+        if (bidderUID.length() != UID_LEN ||
+            toInt(bidderUID, bid.bidderUID) ||
+            toInt(nextToken(line), bid.value)) {
+            continue;
+        }
+        nextToken(line); // the date and time of the bid
+        nextToken(line);
+        if (toInt(nextToken(line), bid.secTime)) {
+            continue;
+        }
+        pushBid(info, bids, bid);
+        entries.push_back(std::string(bidderUID) + BIDDED_MARK + " " + AID);
+    }
+    readEndTime(dir, info);
+
+    const std::pair<std::string, std::string> derived[] = {
+        {dir + "/ASSET/name.txt", std::string(assetfName) + "\n"},
+        {dir + "/time.txt", std::to_string(startTime) + "\n" +
+                                std::to_string(duration) + "\n"},
+        {dir + "/BIDS/highest.txt", std::to_string(info.highest) + "\n"}};
+    for (auto const &[path, expected] : derived) {
+        if (!readWholeFile(path, content) || content != expected) {
+            replaceFile(path, expected, false);
+            repaired = 1;
+        }
+    }
+
+    auctionTable->write(toAID(AID), info, bids);
+    return repaired;
+}
+
+// Adds the missing entries to the user indexes, reading each one only once
+static void repairUserIndexes(IndexEntries &entries) {
+    std::sort(entries.begin(), entries.end());
+    entries.erase(std::unique(entries.begin(), entries.end()), entries.end());
+    for (size_t i = 0; i < entries.size();) {
+        std::string UID = entries.at(i).substr(0, UID_LEN), content;
+        std::set<std::string> lines;
+        if (readWholeFile(userIndexPath(UID), content)) {
+            std::istringstream index(content);
+            std::string line;
+            while (std::getline(index, line)) {
+                lines.insert(line);
+            }
+        }
+        std::string missing;
+        for (; i < entries.size() && entries.at(i).substr(0, UID_LEN) == UID;
+             ++i) {
+            std::string line = entries.at(i).substr(UID_LEN);
+            if (lines.count(line) == 0) {
+                missing += line + "\n";
+            }
+        }
+        if (!missing.empty() && std::filesystem::exists("USERS/" + UID)) {
+            std::ofstream index(userIndexPath(UID), std::ios::app);
+            index << missing;
+        }
     }
-    highFile << value << std::endl;
-    highFile.close();
-    uint32_t fullTime, duration;
-    if (!getAuctionTime(AID, fullTime, duration)) {
+}
+
+// Fills the auction table from the data base, with the shards split among
+// numThreads threads. Auctions a crash left half opened are discarded and the
+// files that can be derived are repaired on the way.
+int loadAuctions(unsigned numThreads) {
+    std::vector<std::string> shards;
+    try {
+        shards = listDirectory("AUCTIONS");
+    } catch (std::filesystem::filesystem_error &e) {
+        std::cerr << RECOVERY_ERR << e.what() << std::endl;
         return 0;
     }
-    bidsFile << UID << " " << value << " " << toDate(currentTime) << " "
-             << (uint32_t)currentTime - fullTime << std::endl;
-    bidsFile.close();
+    shards.erase(std::remove_if(shards.begin(), shards.end(),
+                                [](const std::string &name) {
+                                    return !isShard(name);
+                                }),
+                 shards.end());
+
+    std::atomic<size_t> nextShard{0}, numDiscarded{0}, numRepaired{0};
+    std::atomic<bool> failed{false};
+    std::mutex entriesLock;
+    IndexEntries allEntries;
+    auto loader = [&]() {
+        IndexEntries entries;
+        size_t i;
+        while ((i = nextShard.fetch_add(1)) < shards.size()) {
+            std::string shardDir = "AUCTIONS/" + shards.at(i);
+            try {
+                for (const std::string &name : listDirectory(shardDir)) {
+                    // auctions being opened are staged under another name
+                    int res = isAID(name) ? loadAuction(name, entries) : -1;
+                    if (res < 0) {
+                        std::filesystem::remove_all(shardDir + "/" + name);
+                        ++numDiscarded;
+                    }
+                    numRepaired += res > 0;
+                }
+            } catch (std::filesystem::filesystem_error &e) {
+                std::cerr << RECOVERY_ERR << e.what() << std::endl;
+                failed = true;
+            }
+        }
+        std::lock_guard<std::mutex> guard(entriesLock);
+        allEntries.insert(allEntries.end(), entries.begin(), entries.end());
+    };
 
-    std::ofstream userBidFile("USERS/" + UID + "/BIDDED/" + AID);
-    if (!userBidFile.is_open()) {
+    numThreads = std::max(1u, std::min(numThreads, (unsigned)shards.size()));
+    std::vector<std::thread> threads;
+    for (unsigned t = 1; t < numThreads; ++t) {
+        threads.emplace_back(loader);
+    }
+    loader();
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+    if (failed) {
         return 0;
     }
-    userBidFile.close();
 
+    repairUserIndexes(allEntries);
+    if (numDiscarded > 0 || numRepaired > 0) {
+        std::cout << RECOVERY_DONE(numDiscarded, numRepaired) << std::endl;
+    }
     return 1;
 }
 
-int getAuctionAsset(std::string AID, std::string &fPath) {
-    std::ifstream nameFile("AUCTIONS/" + AID + "/ASSET/name.txt");
-    if (!nameFile.is_open()) {
+// Brings a table loaded from a snapshot up to date with the data base. Only
+// the auctions whose bids journal no longer has the size in the table are
+// read again, along with the ones opened after the snapshot was taken.
+int loadChangedAuctions() {
+    size_t numDiscarded = 0, numRepaired = 0;
+    IndexEntries entries;
+    uint32_t count = auctionTable->count.load(std::memory_order_acquire);
+    auto reload = [&](const std::string &AID) {
+        int res = loadAuction(AID, entries);
+        if (res < 0) {
+            std::filesystem::remove_all(auctionPath(AID));
+            if (toAID(AID) <= count) {
+                // the snapshot still has it in the table
+                auctionTable->write(toAID(AID), AuctionInfo{});
+            }
+            ++numDiscarded;
+        }
+        numRepaired += res > 0;
+    };
+
+    for (uint32_t AID = 1; AID <= count; ++AID) {
+        AuctionInfo info;
+        if (!auctionTable->read(AID, info)) {
+            continue; // discarded by an earlier recovery
+        }
+        std::string dir = auctionPath(fromAID(AID));
+        struct stat st;
+        if (stat((dir + "/BIDS/list.txt").c_str(), &st) != 0 ||
+            (uint64_t)st.st_size != info.journalSize) {
+            reload(fromAID(AID));
+        } else if (info.endTime == 0) {
+            // closed or found expired after the snapshot
+            readEndTime(dir, info);
+            if (info.endTime != 0) {
+                auctionTable->write(AID, info);
+            }
+        }
+    }
+    try {
+        for (uint32_t AID = count + 1; AID <= MAX_AUCTIONS &&
+                                       std::filesystem::exists(
+                                           auctionPath(fromAID(AID)));
+             ++AID) {
+            reload(fromAID(AID));
+        }
+    } catch (std::filesystem::filesystem_error &e) {
+        std::cerr << RECOVERY_ERR << e.what() << std::endl;
         return 0;
     }
-    std::getline(nameFile, fPath);
-    fPath = "AUCTIONS/" + AID + "/ASSET/" + fPath;
-    nameFile.close();
+    // The AIDs of the discarded auctions at the end are given out again
+    count = auctionTable->count.load(std::memory_order_acquire);
+    AuctionInfo last;
+    while (count > 0 && !auctionTable->read(count, last)) {
+        auctionTable->count.store(--count, std::memory_order_release);
+    }
+
+    repairUserIndexes(entries);
+    if (numDiscarded > 0 || numRepaired > 0) {
+        std::cout << RECOVERY_DONE(numDiscarded, numRepaired) << std::endl;
+    }
     return 1;
 }
@@ -9,6 +9,12 @@
 #include <unistd.h>
 #include <vector>
 
+// Markers of the auctions in the index of each user
+constexpr char HOSTED_MARK = 'H';
+constexpr char BIDDED_MARK = 'B';
+
+std::string auctionPath(const std::string &AID);
+uint32_t toAID(const std::string &AID); // 0 if it's not a number
 int checkRegister(const std::string UID);
 int checkLoggedIn(std::string UID);
 int checkLoginMatch(std::string UID, std::string password);
@@ -19,16 +25,35 @@ int unregisterUser(std::string UID);
 int getAuctionTime(std::string AID, uint32_t &fullTime, uint32_t &duration);
 int checkAuctionExpiration(std::string AID, time_t &currentTime);
 uint8_t getAuctionState(std::string AID);
-int getAuctions(std::string path, std::vector<Auction> &auctions);
+int getAllAuctions(std::vector<Auction> &auctions);
+int getAuctionsPage(uint32_t cursor, uint32_t pageSize, bool activeOnly,
+                    std::vector<Auction> &auctions, uint32_t &next);
+// within 0 lists all of the active auctions
+int getEndingAuctions(uint32_t within, bool byEndTime,
+                      std::vector<Auction> &auctions);
+int getAuctionsRange(uint32_t from, uint32_t to,
+                     std::vector<Auction> &auctions);
+int getUserAuctions(std::string UID, char mark,
+                    std::vector<Auction> &auctions);
+int addUserAuction(std::string UID, std::string AID, char mark);
 int closeAuction(std::string AID);
 int checkAuctionExists(std::string AID);
 int checkUserHostedAuction(std::string UID, std::string AID);
-std::string getNewAID();
+std::string getNewAID(uint32_t maxAuctions);
+// The asset is moved into the auction from assetPath
 int openAuction(std::string newAID, std::string UID, std::string auctionName,
-                std::string assetfName, uint32_t startValue, uint32_t duration);
+                std::string assetfName, uint32_t startValue, uint32_t duration,
+                const std::string &assetPath);
 int getAuctionRecord(std::string AID, std::string &info);
+// The bids after the first seq ones and the end, or unchanged if there are
+// no new bids and the auction is still active
+int getAuctionRecordSince(std::string AID, uint32_t seq, std::string &info,
+                          bool &unchanged);
 int bidAuction(std::string AID, std::string UID, uint32_t value,
                time_t currentTime);
 int getAuctionAsset(std::string AID, std::string &fPath);
+int migrateStorage();
+int loadAuctions(unsigned numThreads);
+int loadChangedAuctions();
 
 #endif // __PERSISTANCE_HPP__
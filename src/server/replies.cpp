@@ -0,0 +1,41 @@
+#include "replies.hpp"
+
+CachedReply &ReplyCache::slot(const struct sockaddr_in &from) {
+    uint64_t key = (uint64_t)from.sin_addr.s_addr << 16 | from.sin_port;
+    key *= 0x9E3779B97F4A7C15ULL; // Fibonacci hashing
+    return this->entries[(key >> 32) % REPLY_CACHE_SLOTS];
+}
+
+const std::string *ReplyCache::find(const struct sockaddr_in &from,
+                                    const std::string &request, uint64_t now,
+                                    uint64_t version, time_t clock) {
+    if (this->ttl == 0) {
+        return NULL;
+    }
+    CachedReply &entry = this->slot(from);
+    if (entry.addr != from.sin_addr.s_addr || entry.port != from.sin_port ||
+        entry.expires <= now || entry.version != version ||
+        entry.users != this->users ||
+        (entry.endsAt != 0 && clock >= entry.endsAt) ||
+        entry.request != request) {
+        return NULL;
+    }
+    return &entry.reply;
+}
+
+void ReplyCache::store(const struct sockaddr_in &from,
+                       const std::string &request, const std::string &reply,
+                       uint64_t now, uint64_t version, time_t endsAt) {
+    if (this->ttl == 0) {
+        return;
+    }
+    CachedReply &entry = this->slot(from);
+    entry.addr = from.sin_addr.s_addr;
+    entry.port = from.sin_port;
+    entry.expires = now + this->ttl;
+    entry.version = version;
+    entry.users = this->users;
+    entry.endsAt = endsAt;
+    entry.request = request;
+    entry.reply = reply;
+}
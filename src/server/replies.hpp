@@ -0,0 +1,52 @@
+#ifndef __REPLIES_HPP__
+#define __REPLIES_HPP__
+
+#include "../lib/constants.hpp"
+
+#include <cstdint>
+#include <ctime>
+#include <netinet/in.h>
+#include <string>
+
+typedef struct {
+    uint32_t addr = 0; // of the client, 0 if the entry is empty
+    uint16_t port;
+    uint64_t expires; // monotonic milliseconds
+    uint64_t version; // of the auction table when it was computed
+    uint64_t users;   // epoch of the users when it was computed
+    time_t endsAt;    // when the next auction ends after that, 0 if none
+    std::string request;
+    std::string reply;
+} CachedReply;
+
+// The last reply sent to each client over UDP, sent again if the client
+// retransmits the same request before the TTL runs out and no auction or user
+// changed and no auction ended, instead of handling it twice. Only the last
+// request of a client is kept, so a request repeated after another one (a
+// login after a logout) is handled again. Clients whose addresses hash to the
+// same slot evict each other.
+class ReplyCache {
+  public:
+    uint32_t ttl = REPLY_CACHE_TTL_MS; // 0 disables it
+
+    // NULL if there is no reply for the request. clock is the time of the
+    // coarse clock, which the end times of the auctions are compared to.
+    const std::string *find(const struct sockaddr_in &from,
+                            const std::string &request, uint64_t now,
+                            uint64_t version, time_t clock);
+    void store(const struct sockaddr_in &from, const std::string &request,
+               const std::string &reply, uint64_t now, uint64_t version,
+               time_t endsAt);
+    // Called when a user registers, logs in or out, or unregisters. The
+    // replies of LIN, LOU, UNR, LMA and LMB depend on the files of the users,
+    // which the version of the auction table does not count.
+    void changedUsers() { ++this->users; }
+
+  private:
+    CachedReply entries[REPLY_CACHE_SLOTS];
+    uint64_t users = 0; // epoch, advanced by every change to the users
+
+    CachedReply &slot(const struct sockaddr_in &from);
+};
+
+#endif // __REPLIES_HPP__
@@ -1,6 +1,9 @@
 #include "server.hpp"
 #include "../lib/messages.hpp"
+#include "clock.hpp"
 #include "packets.hpp"
+#include "persistance.hpp"
+#include "timers.hpp"
 
 #include <algorithm>
 #include <arpa/inet.h>
@@ -18,12 +21,19 @@ int main(int argc, char *argv[]) {
 
     state.readOpts(argc, argv);
     checkPort(state.port);
+    state.setupMetrics();
+    state.setupTable();
+    serverClock.tick();
     state.openUDPSocket();
     state.openTCPSocket();
     state.getServerAddresses();
 
-    state.cverbose << "[INFO] Verbose mode is activated." << std::endl;
+    state.cverbose << "Verbose mode is activated." << std::endl;
 
+    if (!state.dataDir.empty() && chdir(state.dataDir.c_str()) != 0) {
+        std::cerr << DATA_DIR_ERR << strerror(errno) << std::endl;
+        return EXIT_FAILURE;
+    }
     std::filesystem::create_directory("USERS");
     std::filesystem::create_directory("AUCTIONS");
     if (!std::filesystem::exists("USERS") ||
@@ -32,8 +42,26 @@ int main(int argc, char *argv[]) {
                   << std::endl;
         return EXIT_FAILURE;
     }
+    if (!migrateStorage()) {
+        std::cerr << "[ERR] Can't migrate the data base to the current layout."
+                  << std::endl;
+        return EXIT_FAILURE;
+    }
+    UploadTable::removeStale();
+    auto loadStart = std::chrono::steady_clock::now();
+    bool fromSnapshot =
+        state.snapshot && loadSnapshot(auctionTable, SNAPSHOT_FILE);
+    if (fromSnapshot ? !loadChangedAuctions()
+                     : !loadAuctions(state.loaderThreads)) {
+        return EXIT_FAILURE;
+    }
+    std::cout << LOADED_AUCTIONS(auctionTable->count.load(),
+                                 fromSnapshot ? "snapshot" : "data base",
+                                 elapsedMicros(loadStart) / 1000)
+              << std::endl;
 
-    // Get both UDP and TCP listeners running
+    // Get both UDP and TCP listeners running, each with its own log thread
+    state.logger.drain();
     pid_t pid = fork();
     if (pid == -1) {
         std::cerr << "[ERR] Failed to fork into UDP and TCP listeners."
@@ -43,14 +71,24 @@ int main(int argc, char *argv[]) {
         mainTCP();
         return EXIT_SUCCESS;
     } else { // Parent (UDP listener)
+        SnapshotWriter snapshotWriter;
+        if (state.snapshot) {
+            snapshotWriter.start(auctionTable, SNAPSHOT_FILE,
+                                 state.snapshotInterval);
+        }
         mainUDP();
+        snapshotWriter.stop();
     }
 
     wait(NULL);
+    if (state.snapshot && !saveSnapshot(auctionTable, SNAPSHOT_FILE)) {
+        std::cerr << SNAPSHOT_ERR << std::endl;
+    }
     return EXIT_SUCCESS;
 }
 
 void mainUDP() {
+    state.logger.start();
     while (!state.shutDown) {
         // LIN_LEN is the max size of a UDP message the server should receive
         char buffer[LIN_LEN + 1] = {0};
@@ -66,14 +104,15 @@ void mainUDP() {
             std::cerr << RECVFROM_ERR << std::endl;
             continue;
         }
+        serverClock.tick();
+        state.stats->countBytes((uint64_t)n, 0);
         char strAddr[INET_ADDRSTRLEN + 1] = {0};
         inet_ntop(AF_INET, &UDPFrom.addr.sin_addr, strAddr, INET_ADDRSTRLEN);
         state.cverbose << UDP_CONNECTION << strAddr << ":"
                        << ntohs(UDPFrom.addr.sin_port) << std::endl;
         if (n <= PACKET_ID_LEN || n == LIN_LEN) { // invalid Packet size
             ERRUDPPacket err;
-            sendUDPPacket(err, (struct sockaddr *)&UDPFrom.addr,
-                          UDPFrom.addrlen, state.socketUDP);
+            replyUDPPacket(state, err, "ERR", UDPFrom);
             state.cverbose << "| " << UNKNOWN_MSG << std::endl;
             continue;
         }
@@ -81,26 +120,61 @@ void mainUDP() {
         std::string msg(buffer);
         interpretUDPPacket(state, msg, UDPFrom);
     }
+    state.logger.stop();
     std::cout << std::endl << SHUTDOWN_UDP_SERVER << std::endl;
 }
 
 void mainTCP() {
-    if (listen(state.socketTCP, MAX_TCP_QUEUE) == -1) {
+    state.stats = &state.metrics->shards[TCP_SHARD];
+    state.logger.start();
+    if (listen(state.socketTCP, state.backlog) == -1) {
         std::cerr << TCP_LISTEN_ERR << std::endl;
         return;
     }
 
     std::vector<Connection> conns(FD_SETSIZE);
+    std::vector<int> active; // fds of the open connections
+    TimerHeap timers;
+    uint64_t nextConnID = 0;
+    uint64_t resumeAccepts = 0; // while accepts are paused, 0 otherwise
+    const uint64_t readTimeoutMillis = state.readTimeout * 1000ULL;
     int fds, maxfd = state.socketTCP, numConns = 0;
     fd_set tmp, rdfs;
     FD_ZERO(&rdfs);
     FD_SET(state.socketTCP, &rdfs);
-    struct timeval tv;
-    memset(&tv, 0, sizeof(tv));
-    tv.tv_sec = READ_TIMEOUT_SECS;
+    auto dropConnection = [&](Connection &conn) {
+        state.uploads.endChunk(conn.fd);
+        close(conn.fd);
+        FD_CLR(conn.fd, &rdfs);
+        conn.closed = true;
+        active.at(conn.slot) = active.back();
+        conns.at((size_t)active.back()).slot = conn.slot;
+        active.pop_back();
+        --numConns;
+        resumeAccepts = 0; // a descriptor was freed
+        FD_SET(state.socketTCP, &rdfs);
+    };
     while (!state.shutDown) {
+        // Wait at most until the earliest read deadline
+        struct timeval tv, *timeout = NULL;
+        uint64_t now = monotonicMillis();
+        int64_t wait = timers.timeout(now);
+        serverClock.tick(); // the handlers may have taken long
+        int64_t untilEnd = state.events.timeout(serverClock.now());
+        if (untilEnd >= 0) {
+            wait = wait < 0 ? untilEnd : std::min(wait, untilEnd);
+        }
+        if (resumeAccepts != 0) {
+            int64_t pause = (int64_t)(std::max(resumeAccepts, now) - now);
+            wait = wait < 0 ? pause : std::min(wait, pause);
+        }
+        if (wait >= 0) {
+            tv.tv_sec = (time_t)(wait / 1000);
+            tv.tv_usec = (suseconds_t)(wait % 1000 * 1000);
+            timeout = &tv;
+        }
         tmp = rdfs;
-        fds = select(maxfd + 1, &tmp, (fd_set *)NULL, (fd_set *)NULL, &tv);
+        fds = select(maxfd + 1, &tmp, (fd_set *)NULL, (fd_set *)NULL, timeout);
         if (fds == -1) {
             if (errno == EINTR) { // shutDown
                 break;
@@ -108,56 +182,133 @@ void mainTCP() {
             std::cerr << SELECT_ERR << strerror(errno) << std::endl;
             continue;
         }
+        serverClock.tick();
+        state.events.publishEnded(serverClock.now());
+
+        // Expire the idle connections, skipping timers of closed ones
+        now = monotonicMillis();
+        while (!timers.empty() && timers.top().deadline <= now) {
+            Timer timer = timers.top();
+            timers.pop();
+            Connection &conn = conns.at((size_t)timer.fd);
+            if (conn.connID != timer.connID || conn.closed ||
+                state.events.isSubscribed(timer.fd)) {
+                continue;
+            }
+            if (state.uploads.chunk(timer.fd) != NULL &&
+                (conn.deadline > now || FD_ISSET(timer.fd, &tmp))) {
+                // the data of the chunk is still arriving, and each piece
+                // pushes the deadline back
+                timers.push(std::max(conn.deadline, now + readTimeoutMillis),
+                            timer.fd, timer.connID);
+                continue;
+            }
+            if (FD_ISSET(timer.fd, &tmp)) {
+                continue;
+            }
+            state.cwarn << TCP_REFUSE << conn.host << ":" << conn.port
+                        << std::endl;
+            ERRTCPPacket err;
+            replyTCPPacket(state, err, "ERR", timer.fd);
+            state.stats->timeoutConnection(timer.fd);
+            dropConnection(conn);
+        }
 
-        for (int fd = 0; fd < maxfd + 1; ++fd) {
-            if (fd != state.socketTCP && FD_ISSET(fd, &rdfs)) {
-                Connection conn = conns.at((size_t)fd);
-                if ((uint32_t)time(NULL) - conn.time >= READ_TIMEOUT_SECS) {
-                    state.cverbose << TCP_REFUSE << conn.host << ":"
-                                   << conn.port << std::endl;
-                    ERRTCPPacket err;
-                    err.serialize(fd);
-                    close(fd);
-                    FD_CLR(fd, &rdfs);
-                    --numConns;
+        for (size_t i = 0; i < active.size();) {
+            int fd = active.at(i);
+            if (!FD_ISSET(fd, &tmp)) {
+                ++i;
+                continue;
+            }
+            Connection &conn = conns.at((size_t)fd);
+            if (state.events.isSubscribed(fd)) {
+                // the subscriber left, or could not keep up with the events
+                state.cverbose << TCP_UNSUBSCRIBED << conn.host << ":"
+                               << conn.port << std::endl;
+                state.events.unsubscribe(fd);
+                state.stats->closeConnection(fd);
+                dropConnection(conn);
+                continue;
+            }
+            if (state.uploads.chunk(fd) != NULL) {
+                UPCDataHandler(state, fd);
+                if (state.uploads.chunk(fd) != NULL) {
+                    conn.deadline = monotonicMillis() + readTimeoutMillis;
+                    ++i; // the rest of the data has yet to arrive
                     continue;
                 }
-                if (FD_ISSET(fd, &tmp)) {
-                    state.cverbose << TCP_CONNECTION << conn.host << ":"
-                                   << conn.port << std::endl;
-                    interpretTCPPacket(state, fd);
-                    close(fd);
-                    FD_CLR(fd, &rdfs);
-                    --numConns;
-                }
+                state.stats->closeConnection(fd);
+                dropConnection(conn);
+                continue;
             }
-        }
-        if (FD_ISSET(state.socketTCP, &tmp)) {
-            if (numConns++ > MAX_TCP_CONNS) {
-                state.cverbose
-                    << "Maximum number of concurrent connections reached."
-                    << std::endl;
+            state.cverbose << TCP_CONNECTION << conn.host << ":" << conn.port
+                           << std::endl;
+            // handlers block, so the previous one may have taken long. The
+            // auctions that ended meanwhile are published before a new one
+            // can drop them from the end index.
+            serverClock.tick();
+            state.events.publishEnded(serverClock.now());
+            interpretTCPPacket(state, fd);
+            if (state.events.isSubscribed(fd)) {
+                ++i; // kept open for the events, without a read deadline
+                continue;
+            }
+            if (state.uploads.chunk(fd) != NULL) {
+                conn.deadline = monotonicMillis() + readTimeoutMillis;
+                ++i; // its data is read as it arrives
                 continue;
             }
+            state.stats->closeConnection(fd);
+            dropConnection(conn);
+        }
+        if (resumeAccepts != 0 && now >= resumeAccepts) {
+            resumeAccepts = 0;
+            FD_SET(state.socketTCP, &rdfs);
+        }
+        if (FD_ISSET(state.socketTCP, &tmp)) {
             Connection conn;
             if (!acceptConnection(conn)) {
+                if (errno == EMFILE || errno == ENFILE) {
+                    // The pending connection would wake select() right away
+                    state.cwarn << TCP_ACCEPT_PAUSED << strerror(errno)
+                                << std::endl;
+                    FD_CLR(state.socketTCP, &rdfs);
+                    resumeAccepts = now + ACCEPT_PAUSE_MS;
+                }
+                continue;
+            }
+            if (numConns >= state.maxConns || conn.fd >= FD_SETSIZE) {
+                // Answer right away instead of leaving it in the backlog
+                state.cwarn << TCP_BUSY << conn.host << ":" << conn.port
+                            << std::endl;
+                ERRTCPPacket err;
+                replyTCPPacket(state, err, "ERR", conn.fd);
+                drainTCPSocket(conn.fd);
+                state.stats->refuseConnection();
+                close(conn.fd);
                 continue;
             }
+            ++numConns;
+            state.stats->openConnection();
+            conn.connID = nextConnID++;
+            conn.slot = active.size();
             conns.at((size_t)conn.fd) = conn;
+            timers.push(conn.deadline, conn.fd, conn.connID);
+            active.push_back(conn.fd);
             FD_SET(conn.fd, &rdfs);
             maxfd = std::max(maxfd, conn.fd);
         }
     }
-    for (int fd = 0; fd < maxfd + 1; ++fd) {
-        if (fd != state.socketTCP && FD_ISSET(fd, &rdfs)) {
-            Connection conn = conns.at((size_t)fd);
-            state.cverbose << TCP_REFUSE << conn.host << ":" << conn.port
-                           << std::endl;
-            ERRTCPPacket err;
-            err.serialize(fd);
-            close(fd);
-        }
+    for (int fd : active) {
+        Connection &conn = conns.at((size_t)fd);
+        state.cwarn << TCP_REFUSE << conn.host << ":" << conn.port
+                    << std::endl;
+        ERRTCPPacket err;
+        replyTCPPacket(state, err, "ERR", fd);
+        state.stats->timeoutConnection(fd);
+        close(fd);
     }
+    state.logger.stop();
     std::cout << std::endl << SHUTDOWN_TCP_SERVER << std::endl;
 }
 
@@ -166,22 +317,27 @@ int acceptConnection(Connection &conn) {
     conn.fd = accept(state.socketTCP, (struct sockaddr *)&TCPFrom.addr,
                      &TCPFrom.addrlen);
     if (conn.fd == -1) {
-        std::cerr << TCP_ACCEPT_ERR << std::endl;
+        if (errno != EMFILE && errno != ENFILE) { // handled by the caller
+            std::cerr << TCP_ACCEPT_ERR << std::endl;
+        }
         return 0;
     }
     struct timeval tv;
     memset(&tv, 0, sizeof(tv));
-    tv.tv_sec = READ_TIMEOUT_SECS;
+    tv.tv_sec = state.readTimeout;
     if (setsockopt(conn.fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv)) != 0) {
         std::cerr << SOCKET_TIMEOUT_ERR << strerror(errno) << std::endl;
+        close(conn.fd);
         return 0;
     }
-    tv.tv_sec = WRITE_TIMEOUT_SECS;
+    tv.tv_sec = state.writeTimeout;
     if (setsockopt(conn.fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv)) != 0) {
         std::cerr << SOCKET_TIMEOUT_ERR << strerror(errno) << std::endl;
+        close(conn.fd);
         return 0;
     }
-    conn.time = (uint32_t)time(NULL);
+    conn.deadline = monotonicMillis() + state.readTimeout * 1000ULL;
+    conn.closed = false;
 
     memset(conn.host, 0, sizeof(conn.host));
     inet_ntop(AF_INET, &TCPFrom.addr.sin_addr, conn.host, INET_ADDRSTRLEN);
@@ -190,11 +346,39 @@ int acceptConnection(Connection &conn) {
 }
 
 void printHelp(std::ostream &stream, char *programPath) {
-    stream << "Usage: " << programPath << " [-p ASport] [-v] [-h]" << std::endl;
+    stream << "Usage: " << programPath
+           << " [-f config] [-o key=value]... [-p ASport] [-v] [-l logfile]"
+              " [-d datadir] [-q backlog] [-c conns] [-r class=rate]... [-h]"
+           << std::endl;
     stream << "Available options:" << std::endl;
+    stream << "-f config\tRead the options from a file with one key = value "
+              "per line. The other options take precedence over it."
+           << std::endl;
+    stream << "-o key=value\tSet any option by its config file key: port, "
+              "verbose, log_file, log_rate, data_dir, backlog, max_conns, "
+              "read_timeout, write_timeout, file_buffer, max_auctions, "
+              "loader_threads, snapshot, snapshot_interval, reply_cache_ttl, "
+              "query_rate, control_rate and transfer_rate."
+           << std::endl;
     stream << "-p ASport\tSet port of Auction Server. Default is: "
            << DEFAULT_AS_PORT << std::endl;
     stream << "-v\t\tTo run the server in verbose mode." << std::endl;
+    stream << "-l logfile\tAppend the log to the given file instead of the "
+              "standard output."
+           << std::endl;
+    stream << "-d datadir\tKeep the USERS and AUCTIONS directories in the "
+              "given directory. Default is the current one."
+           << std::endl;
+    stream << "-q backlog\tSet the length of the queue of pending TCP "
+              "connections. Default is: "
+           << MAX_TCP_QUEUE << std::endl;
+    stream << "-c conns\tSet the maximum number of open TCP connections, "
+              "the ones over it are answered with ERR. Default is: "
+           << MAX_TCP_CONNS << std::endl;
+    stream << "-r class=rate\tLimit the requests per second of a class "
+              "(query, control or transfer), the ones over it are answered "
+              "with ERR. Default is no limit."
+           << std::endl;
     stream << "-h\t\tPrint this help menu." << std::endl;
 }
 
@@ -7,7 +7,10 @@
 
 typedef struct {
     int fd;
-    uint32_t time;
+    uint64_t connID;
+    uint64_t deadline; // monotonic milliseconds to receive the request
+    bool closed;
+    size_t slot; // position in the list of open connections
     char host[INET_ADDRSTRLEN + 1];
     uint16_t port;
 } Connection;
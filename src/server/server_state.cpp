@@ -1,21 +1,63 @@
 #include "server_state.hpp"
 #include "../lib/messages.hpp"
+#include "../lib/protocol.hpp"
+#include "../lib/utils.hpp"
 #include "server.hpp"
 
 #include <cstring>
+#include <fstream>
 #include <iostream>
+#include <sys/select.h>
 #include <sys/socket.h>
 #include <unistd.h>
 
 void ServerState::readOpts(int argc, char *argv[]) {
     int opt;
-    while ((opt = getopt(argc, argv, "p:vh")) != -1) {
+    const char *optString = "f:o:p:vl:d:q:c:r:h";
+
+    // The config file goes first, so that the other options override it
+    opterr = 0;
+    while ((opt = getopt(argc, argv, optString)) != -1) {
+        if (opt == 'f') {
+            this->readConfig(optarg);
+        }
+    }
+    opterr = 1;
+    optind = 1;
+
+    while ((opt = getopt(argc, argv, optString)) != -1) {
+        std::string arg = optarg != NULL ? optarg : "";
+        size_t sep = arg.find('=');
+        int res = 0;
         switch (opt) {
+        case 'f':
+            break;
+        case 'o':
+            res = sep == std::string::npos ||
+                  this->setOption(arg.substr(0, sep), arg.substr(sep + 1));
+            break;
         case 'p':
-            this->port = std::string(optarg);
+            res = this->setOption("port", arg);
             break;
         case 'v':
-            this->cverbose.active = true;
+            res = this->setOption("verbose", "1");
+            break;
+        case 'l':
+            res = this->setOption("log_file", arg);
+            break;
+        case 'd':
+            res = this->setOption("data_dir", arg);
+            break;
+        case 'q':
+            res = this->setOption("backlog", arg);
+            break;
+        case 'c':
+            res = this->setOption("max_conns", arg);
+            break;
+        case 'r':
+            res = sep == std::string::npos ||
+                  this->setOption(arg.substr(0, sep) + "_rate",
+                                  arg.substr(sep + 1));
             break;
         case 'h':
             printHelp(std::cout, argv[0]);
@@ -24,6 +66,141 @@ void ServerState::readOpts(int argc, char *argv[]) {
             printHelp(std::cerr, argv[0]);
             exit(EXIT_FAILURE);
         }
+        if (res) {
+            std::cerr << OPTION_ERR(opt, arg) << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+int ServerState::setOption(const std::string &key, const std::string &value) {
+    uint32_t num = 0;
+    bool isNum = !toInt(value, num);
+    const std::string rateSuffix = "_rate";
+
+    if (key == "port") {
+        this->port = value;
+    } else if (key == "verbose") {
+        if (!isNum || num > 1) {
+            return 1;
+        }
+        this->logger.level = num ? LOG_INFO : LOG_WARN;
+    } else if (key == "log_file") {
+        return this->logger.openFile(value);
+    } else if (key == "log_rate") {
+        if (!isNum) {
+            return 1;
+        }
+        this->logger.rateLimit = num;
+    } else if (key == "data_dir") {
+        if (value.empty()) {
+            return 1;
+        }
+        this->dataDir = value;
+    } else if (key == "backlog") {
+        if (!isNum || num == 0) {
+            return 1;
+        }
+        this->backlog = (int)num;
+    } else if (key == "max_conns") {
+        if (!isNum || num == 0 || num >= FD_SETSIZE - 8) {
+            return 1;
+        }
+        this->maxConns = (int)num;
+    } else if (key == "read_timeout") {
+        if (!isNum || num == 0) {
+            return 1;
+        }
+        this->readTimeout = num;
+    } else if (key == "write_timeout") {
+        if (!isNum || num == 0) {
+            return 1;
+        }
+        this->writeTimeout = num;
+    } else if (key == "file_buffer") {
+        if (!isNum || num == 0 || num > MAX_FILE_BUFFER_SIZE) {
+            return 1;
+        }
+        TCPPacket::fileBufferSize = num;
+    } else if (key == "loader_threads") {
+        if (!isNum || num == 0) {
+            return 1;
+        }
+        this->loaderThreads = num;
+    } else if (key == "snapshot") {
+        if (!isNum || num > 1) {
+            return 1;
+        }
+        this->snapshot = num;
+    } else if (key == "snapshot_interval") {
+        if (!isNum) {
+            return 1;
+        }
+        this->snapshotInterval = num;
+    } else if (key == "reply_cache_ttl") {
+        if (!isNum) {
+            return 1;
+        }
+        this->replies.ttl = num;
+    } else if (key == "max_auctions") {
+        if (!isNum || num == 0 || num > MAX_AUCTIONS) {
+            return 1;
+        }
+        this->maxAuctions = num;
+    } else if (key.length() > rateSuffix.length() &&
+               key.compare(key.length() - rateSuffix.length(),
+                           rateSuffix.length(), rateSuffix) == 0) {
+        return this->admission.setLimit(
+            key.substr(0, key.length() - rateSuffix.length()) + "=" + value);
+    } else {
+        return 1;
+    }
+    return 0;
+}
+
+// One "key = value" per line, with # starting a comment
+void ServerState::readConfig(const std::string &path) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        std::cerr << CONFIG_FILE_ERR << path << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    auto trim = [](const std::string &str) {
+        size_t first = str.find_first_not_of(" \t\r");
+        if (first == std::string::npos) {
+            return std::string();
+        }
+        return str.substr(first, str.find_last_not_of(" \t\r") - first + 1);
+    };
+
+    std::string line;
+    for (size_t lineNum = 1; std::getline(file, line); ++lineNum) {
+        line = trim(line.substr(0, line.find('#')));
+        if (line.empty()) {
+            continue;
+        }
+        size_t sep = line.find('=');
+        if (sep == std::string::npos ||
+            this->setOption(trim(line.substr(0, sep)),
+                            trim(line.substr(sep + 1)))) {
+            std::cerr << CONFIG_LINE_ERR(path, lineNum) << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+void ServerState::setupMetrics() {
+    if ((this->metrics = createMetrics()) == NULL) {
+        std::cerr << METRICS_ERR << strerror(errno) << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    this->stats = &this->metrics->shards[UDP_SHARD];
+}
+
+void ServerState::setupTable() {
+    if ((auctionTable = createAuctionTable()) == NULL) {
+        std::cerr << TABLE_ERR << strerror(errno) << std::endl;
+        exit(EXIT_FAILURE);
     }
 }
 
@@ -98,4 +275,6 @@ ServerState::~ServerState() {
     if (this->addrTCP != NULL) {
         freeaddrinfo(this->addrTCP);
     }
+    destroyMetrics(this->metrics);
+    destroyAuctionTable(auctionTable);
 }
@@ -2,55 +2,58 @@
 #define __SERVER_STATE_HPP__
 
 #include "../lib/constants.hpp"
+#include "admission.hpp"
+#include "events.hpp"
+#include "logger.hpp"
+#include "metrics.hpp"
+#include "replies.hpp"
+#include "table.hpp"
+#include "uploads.hpp"
 
 #include <iostream>
 #include <netdb.h>
 #include <string>
-
-class VerboseStream {
-  public:
-    bool active = false;
-
-    template <class T> VerboseStream &operator<<(T rhs) {
-        if (active) {
-            std::cout << rhs;
-        }
-        return *this;
-    }
-    VerboseStream &operator<<(std::ostream &(*pf)(std::ostream &)) {
-        if (active) {
-            pf(std::cout);
-        }
-        return *this;
-    }
-    VerboseStream &operator<<(std::ostream &(*pf)(std::ios &)) {
-        if (active) {
-            pf(std::cout);
-        }
-        return *this;
-    }
-    VerboseStream &operator<<(std::ostream &(*pf)(std::ios_base &)) {
-        if (active) {
-            pf(std::cout);
-        }
-        return *this;
-    }
-};
+#include <thread>
 
 class ServerState {
   public:
     std::string port = DEFAULT_AS_PORT;
-    VerboseStream cverbose;
+    Logger logger;
+    VerboseStream cverbose{logger, LOG_INFO};
+    VerboseStream cwarn{logger, LOG_WARN};
 
     // free with freeaddrinfo(addr);
     struct addrinfo *addrUDP = NULL;
     struct addrinfo *addrTCP = NULL;
     int socketUDP = -1;
     int socketTCP = -1; // current, if any
+    int backlog = MAX_TCP_QUEUE;
+    int maxConns = MAX_TCP_CONNS;
+    uint32_t readTimeout = READ_TIMEOUT_SECS;
+    uint32_t writeTimeout = WRITE_TIMEOUT_SECS;
+    uint32_t maxAuctions = MAX_AUCTIONS;
+    std::string dataDir; // empty is the current directory
+    unsigned loaderThreads = std::thread::hardware_concurrency();
+    bool snapshot = false;
+    uint32_t snapshotInterval = SNAPSHOT_INTERVAL_SECS; // 0 is on exit only
+    Admission admission;
+    EventBus events; // TCP listener only
+    UploadTable uploads; // TCP listener only
+    ReplyCache replies; // UDP listener only
+    std::string lastReply; // last one sent over UDP, for the reply cache
 
     bool shutDown = false;
 
+    // shared between both listeners, each one writing to its own shard
+    Metrics *metrics = NULL;
+    MetricsShard *stats = NULL;
+
     void readOpts(int argc, char *argv[]);
+    // Options have the same keys in the config file and in -o key=value
+    int setOption(const std::string &key, const std::string &value);
+    void readConfig(const std::string &path);
+    void setupMetrics();
+    void setupTable();
     void openUDPSocket();
     void openTCPSocket();
     void getServerAddresses();
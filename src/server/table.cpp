@@ -0,0 +1,348 @@
+#include "table.hpp"
+#include "../lib/messages.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <new>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+AuctionTable *auctionTable = NULL;
+
+typedef struct {
+    char magic[8];
+    uint32_t recordSize; // tells apart snapshots of other builds
+    uint32_t count;
+} SnapshotHeader;
+
+typedef struct {
+    AuctionInfo info;
+    BidRing bids;
+} SnapshotRecord;
+
+static const char SNAPSHOT_MAGIC[8] = "AUCTBL3";
+
+int AuctionTable::read(uint32_t AID, AuctionInfo &info, BidInfo *bids) {
+    if (AID == 0 || AID > this->count.load(std::memory_order_acquire)) {
+        return 0;
+    }
+    AuctionSlot &slot = this->slots[AID - 1];
+    uint32_t before, after;
+    do {
+        before = slot.seq.load(std::memory_order_acquire);
+        memcpy(&info, &slot.info, sizeof(info));
+        if (bids != NULL) {
+            memcpy(bids, slot.bids, sizeof(slot.bids));
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after = slot.seq.load(std::memory_order_relaxed);
+    } while ((before & 1) != 0 || before != after);
+    return info.name[0] != '\0';
+}
+
+void AuctionTable::write(uint32_t AID, const AuctionInfo &info,
+                         const BidInfo *bids) {
+    AuctionSlot &slot = this->slots[AID - 1];
+    uint32_t seq = slot.seq.load(std::memory_order_relaxed);
+    slot.seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(&slot.info, &info, sizeof(info));
+    if (bids != NULL) {
+        memcpy(slot.bids, bids, sizeof(slot.bids));
+    }
+    slot.seq.store(seq + 2, std::memory_order_release);
+
+    uint8_t newFlags = (uint8_t)((info.name[0] != '\0' ? SLOT_IN_USE : 0) |
+                                 (info.endTime != 0 ? SLOT_CLOSED : 0));
+    EndEntry removed = {this->startTimes[AID - 1] + this->durations[AID - 1],
+                        AID};
+    EndEntry added = {(uint32_t)info.startTime + info.duration, AID};
+    bool wasOpen = this->flags[AID - 1] == SLOT_IN_USE;
+    bool isOpen = newFlags == SLOT_IN_USE;
+    if ((wasOpen || isOpen) &&
+        !(wasOpen && isOpen && removed.endTime == added.endTime)) {
+        this->endIndex.update(wasOpen ? &removed : NULL,
+                              isOpen ? &added : NULL,
+                              (uint32_t)info.startTime);
+    }
+
+    this->startTimes[AID - 1] = (uint32_t)info.startTime;
+    this->durations[AID - 1] = info.duration;
+    std::atomic_thread_fence(std::memory_order_release);
+    this->flags[AID - 1] = newFlags;
+    this->version.fetch_add(1, std::memory_order_release);
+    // the loader threads fill different slots at the same time
+    uint32_t last = this->count.load(std::memory_order_relaxed);
+    while (AID > last && !this->count.compare_exchange_weak(
+                             last, AID, std::memory_order_release)) {
+    }
+}
+
+static bool endsBefore(const EndEntry &a, const EndEntry &b) {
+    return a.endTime < b.endTime || (a.endTime == b.endTime && a.AID < b.AID);
+}
+
+void EndIndex::update(const EndEntry *removed, const EndEntry *added,
+                      uint32_t addedStart) {
+    while (this->lock.test_and_set(std::memory_order_acquire)) {
+    }
+    uint32_t changes = this->seq.load(std::memory_order_relaxed);
+    this->seq.store(changes + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    EndEntry *end = this->entries + this->size;
+    if (removed != NULL) {
+        EndEntry *it = std::lower_bound(this->entries, end, *removed,
+                                        endsBefore);
+        if (it != end && it->AID == removed->AID) {
+            std::copy(it + 1, end, it);
+            --end;
+        }
+    }
+    if (added != NULL) {
+        // every auction started before now, so these have already ended
+        EndEntry *expired = std::partition_point(
+            this->entries, end,
+            [addedStart](const EndEntry &e) {
+                return e.endTime <= addedStart;
+            });
+        end = std::copy(expired, end, this->entries);
+        EndEntry *it = std::lower_bound(this->entries, end, *added,
+                                        endsBefore);
+        std::copy_backward(it, end, end + 1);
+        *it = *added;
+        ++end;
+    }
+    this->size = (uint32_t)(end - this->entries);
+
+    this->seq.store(changes + 2, std::memory_order_release);
+    this->lock.clear(std::memory_order_release);
+}
+
+void EndIndex::endingBetween(uint32_t from, uint32_t to,
+                             std::vector<uint32_t> &AIDs) {
+    uint32_t before, after;
+    do {
+        AIDs.clear();
+        before = this->seq.load(std::memory_order_acquire);
+        // a size read in the middle of a change is only used within bounds
+        const EndEntry *end =
+            this->entries + std::min(this->size, (uint32_t)MAX_AUCTIONS);
+        const EndEntry *it = std::partition_point(
+            (const EndEntry *)this->entries, end,
+            [from](const EndEntry &e) { return e.endTime <= from; });
+        for (; it != end && it->endTime <= to; ++it) {
+            AIDs.push_back(it->AID);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after = this->seq.load(std::memory_order_relaxed);
+    } while ((before & 1) != 0 || before != after);
+}
+
+uint32_t EndIndex::nextEnd(uint32_t after) {
+    uint32_t before, next;
+    do {
+        before = this->seq.load(std::memory_order_acquire);
+        const EndEntry *end =
+            this->entries + std::min(this->size, (uint32_t)MAX_AUCTIONS);
+        const EndEntry *it = std::partition_point(
+            (const EndEntry *)this->entries, end,
+            [after](const EndEntry &e) { return e.endTime <= after; });
+        next = it != end ? it->endTime : 0;
+        std::atomic_thread_fence(std::memory_order_acquire);
+    } while ((before & 1) != 0 ||
+             before != this->seq.load(std::memory_order_relaxed));
+    return next;
+}
+
+uint32_t AuctionTable::sweepActive(time_t now,
+                                   uint64_t bitmap[ACTIVE_BITMAP_WORDS]) {
+    uint32_t last = this->count.load(std::memory_order_acquire);
+    ::sweepActive(this->startTimes, this->durations, this->flags, last,
+                  (uint32_t)now, bitmap);
+    return last;
+}
+
+// Same test as isActive, in 32 bits since the elapsed times are small
+static void sweepActiveScalar(const uint32_t *startTimes,
+                              const uint32_t *durations, const uint8_t *flags,
+                              size_t first, size_t n, uint32_t now,
+                              uint64_t *bitmap) {
+    for (size_t i = first; i < n; ++i) {
+        if (flags[i] == SLOT_IN_USE &&
+            (int32_t)(now - startTimes[i]) < (int32_t)durations[i]) {
+            bitmap[i / 64] |= 1ULL << (i % 64);
+        }
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// Eight auctions per iteration, their bits are or'ed in at once
+__attribute__((target("avx2"))) static void
+sweepActiveAVX2(const uint32_t *startTimes, const uint32_t *durations,
+                const uint8_t *flags, size_t n, uint32_t now,
+                uint64_t *bitmap) {
+    const __m256i nowV = _mm256_set1_epi32((int)now);
+    const __m256i inUseV = _mm256_set1_epi32(SLOT_IN_USE);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i start =
+            _mm256_loadu_si256((const __m256i *)(const void *)(startTimes + i));
+        __m256i duration =
+            _mm256_loadu_si256((const __m256i *)(const void *)(durations + i));
+        __m256i flag = _mm256_cvtepu8_epi32(
+            _mm_loadl_epi64((const __m128i *)(const void *)(flags + i)));
+        __m256i elapsed = _mm256_sub_epi32(nowV, start);
+        __m256i active =
+            _mm256_and_si256(_mm256_cmpgt_epi32(duration, elapsed),
+                             _mm256_cmpeq_epi32(flag, inUseV));
+        uint64_t bits =
+            (uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(active));
+        bitmap[i / 64] |= bits << (i % 64);
+    }
+    sweepActiveScalar(startTimes, durations, flags, i, n, now, bitmap);
+}
+#endif
+
+void sweepActive(const uint32_t *startTimes, const uint32_t *durations,
+                 const uint8_t *flags, size_t n, uint32_t now,
+                 uint64_t *bitmap) {
+    memset(bitmap, 0, (n + 63) / 64 * sizeof(uint64_t));
+#if defined(__x86_64__) || defined(__i386__)
+    static const bool hasAVX2 = __builtin_cpu_supports("avx2");
+    if (hasAVX2) {
+        sweepActiveAVX2(startTimes, durations, flags, n, now, bitmap);
+        return;
+    }
+#endif
+    sweepActiveScalar(startTimes, durations, flags, 0, n, now, bitmap);
+}
+
+bool isActive(const AuctionInfo &info, time_t now) {
+    return info.endTime == 0 && now - info.startTime < info.duration;
+}
+
+void pushBid(AuctionInfo &info, BidRing &bids, const BidInfo &bid) {
+    bids[info.numBids % MAX_BIDS_LISTINGS] = bid;
+    info.highest = std::max(info.highest, bid.value);
+    ++info.numBids;
+}
+
+AuctionTable *createAuctionTable() {
+    void *mem = mmap(NULL, sizeof(AuctionTable), PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) {
+        return NULL;
+    }
+    return new (mem) AuctionTable();
+}
+
+void destroyAuctionTable(AuctionTable *table) {
+    if (table != NULL) {
+        munmap(table, sizeof(AuctionTable));
+    }
+}
+
+int saveSnapshot(AuctionTable *table, const std::string &path) {
+    std::string tmpPath = path + ".tmp";
+    int fd = open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1) {
+        return 0;
+    }
+    SnapshotHeader header;
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.recordSize = sizeof(SnapshotRecord);
+    header.count = table->count.load(std::memory_order_acquire);
+    int res = write(fd, &header, sizeof(header)) == sizeof(header);
+    for (uint32_t AID = 1; res && AID <= header.count; ++AID) {
+        SnapshotRecord record;
+        if (!table->read(AID, record.info, record.bids)) {
+            memset(&record, 0, sizeof(record));
+        }
+        res = write(fd, &record, sizeof(record)) == sizeof(record);
+    }
+    res = res && fsync(fd) == 0;
+    if (close(fd) != 0 || !res || rename(tmpPath.c_str(), path.c_str()) != 0) {
+        unlink(tmpPath.c_str());
+        return 0;
+    }
+    return 1;
+}
+
+int loadSnapshot(AuctionTable *table, const std::string &path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd == -1) {
+        return 0;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(SnapshotHeader)) {
+        close(fd);
+        return 0;
+    }
+    size_t size = (size_t)st.st_size;
+    void *mem = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mem == MAP_FAILED) {
+        return 0;
+    }
+
+    const SnapshotHeader *header = (const SnapshotHeader *)mem;
+    const SnapshotRecord *records = (const SnapshotRecord *)(header + 1);
+    int res = memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic)) ==
+                  0 &&
+              header->recordSize == sizeof(SnapshotRecord) &&
+              header->count <= MAX_AUCTIONS &&
+              size == sizeof(SnapshotHeader) +
+                          header->count * sizeof(SnapshotRecord);
+    for (uint32_t AID = 1; res && AID <= header->count; ++AID) {
+        const SnapshotRecord &record = records[AID - 1];
+        if (record.info.name[0] != '\0') {
+            table->write(AID, record.info, record.bids);
+        }
+    }
+    munmap(mem, size);
+    return res;
+}
+
+void SnapshotWriter::start(AuctionTable *table, const std::string &path,
+                           uint32_t intervalSecs) {
+    std::lock_guard<std::mutex> guard(this->lock);
+    if (this->running || intervalSecs == 0) {
+        return;
+    }
+    this->running = true;
+    this->writer = std::thread([this, table, path, intervalSecs]() {
+        std::unique_lock<std::mutex> sleeping(this->lock);
+        while (!this->wakeUp.wait_for(sleeping,
+                                      std::chrono::seconds(intervalSecs),
+                                      [this]() { return !this->running; })) {
+            sleeping.unlock();
+            if (!saveSnapshot(table, path)) {
+                std::cerr << SNAPSHOT_ERR << std::endl;
+            }
+            sleeping.lock();
+        }
+    });
+}
+
+void SnapshotWriter::stop() {
+    {
+        std::lock_guard<std::mutex> guard(this->lock);
+        if (!this->running) {
+            return;
+        }
+        this->running = false;
+    }
+    this->wakeUp.notify_one();
+    this->writer.join();
+}
+
+SnapshotWriter::~SnapshotWriter() { this->stop(); }
@@ -0,0 +1,147 @@
+#ifndef __TABLE_HPP__
+#define __TABLE_HPP__
+
+#include "../lib/constants.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <ctime>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Plain copy of an auction, as read from or written to the table. The fields
+// are sorted by size so the record has no padding in between.
+typedef struct {
+    time_t startTime;
+    time_t endTime; // 0 until it is closed by its host or found expired
+    uint32_t hostUID;
+    uint32_t startValue;
+    uint32_t duration;
+    uint32_t highest; // the start value while there are no bids
+    uint32_t numBids;
+    uint32_t journalSize; // bytes of BIDS/list.txt that are in the table
+    char name[MAX_AUCTION_NAME_LEN + 1]; // empty if the slot is not in use
+    char assetfName[MAX_FILE_NAME_LEN + 1];
+} AuctionInfo;
+
+typedef struct {
+    uint32_t bidderUID;
+    uint32_t value;
+    uint32_t secTime; // since the start of the auction
+} BidInfo;
+
+// The last MAX_BIDS_LISTINGS bids of an auction, the next one is written at
+// numBids % MAX_BIDS_LISTINGS
+typedef BidInfo BidRing[MAX_BIDS_LISTINGS];
+
+// Only the TCP listener writes to the table, so a sequence number per slot,
+// odd while it is being written, lets the UDP listener read consistent copies
+class AuctionSlot {
+  public:
+    std::atomic<uint32_t> seq{0};
+    AuctionInfo info;
+    BidRing bids;
+};
+
+// Flags of a slot in the table
+constexpr uint8_t SLOT_IN_USE = 1;
+constexpr uint8_t SLOT_CLOSED = 2; // or found expired when it was loaded
+
+constexpr size_t ACTIVE_BITMAP_WORDS = (MAX_AUCTIONS + 63) / 64;
+
+typedef struct {
+    uint32_t endTime; // start time plus duration
+    uint32_t AID;
+} EndEntry;
+
+// Auctions that are not closed, ordered by the time they end, so that the
+// active ones are listed without looking at the others. The expired ones are
+// only dropped when a later auction is added, readers skip them. Changed
+// under a lock, since the loader threads write at the same time, and read
+// with a sequence number like the slots.
+class EndIndex {
+  public:
+    std::atomic_flag lock = ATOMIC_FLAG_INIT;
+    std::atomic<uint32_t> seq{0};
+    uint32_t size = 0;
+    EndEntry entries[MAX_AUCTIONS];
+
+    // Either entry may be NULL. The entries that end by the start of the
+    // added auction are expired, and are dropped.
+    void update(const EndEntry *removed, const EndEntry *added,
+                uint32_t addedStart);
+    // AIDs of the auctions that end after from and no later than to, in the
+    // order they end
+    void endingBetween(uint32_t from, uint32_t to,
+                       std::vector<uint32_t> &AIDs);
+    // End time of the first auction that ends after the given time, or 0
+    uint32_t nextEnd(uint32_t after);
+};
+
+class AuctionTable {
+  public:
+    std::atomic<uint32_t> count{0}; // highest AID in use
+    std::atomic<uint64_t> version{0}; // number of writes, to tell stale reads
+    AuctionSlot slots[MAX_AUCTIONS];
+
+    // What the state of an auction depends on, in columns apart from the
+    // slots so that sweeping all of them only touches a few bytes each. They
+    // are written along with the slots, and the flags last.
+    uint32_t startTimes[MAX_AUCTIONS];
+    uint32_t durations[MAX_AUCTIONS];
+    uint8_t flags[MAX_AUCTIONS];
+
+    EndIndex endIndex;
+
+    // Returns 0 if there is no auction with that AID. The bids are only
+    // copied when asked for, most readers just need the info.
+    int read(uint32_t AID, AuctionInfo &info, BidInfo *bids = NULL);
+    void write(uint32_t AID, const AuctionInfo &info,
+               const BidInfo *bids = NULL);
+    // Sets bit AID - 1 of the bitmap for each active auction, up to count
+    uint32_t sweepActive(time_t now, uint64_t bitmap[ACTIVE_BITMAP_WORDS]);
+};
+
+// Sets bit i of the bitmap if auction i is in use, not closed and now is
+// before its start time plus its duration. Uses AVX2 when the CPU has it.
+void sweepActive(const uint32_t *startTimes, const uint32_t *durations,
+                 const uint8_t *flags, size_t n, uint32_t now,
+                 uint64_t *bitmap);
+
+bool isActive(const AuctionInfo &info, time_t now);
+
+// Adds a bid to the ring and to the info of its auction
+void pushBid(AuctionInfo &info, BidRing &bids, const BidInfo &bid);
+
+// Must be called before forking so both listeners share the same table
+AuctionTable *createAuctionTable();
+
+void destroyAuctionTable(AuctionTable *table);
+
+// The snapshot is a copy of the table taken slot by slot, each one
+// consistent on its own. It can be older than the data base, so the
+// auctions that changed since are read again after loading it.
+int saveSnapshot(AuctionTable *table, const std::string &path);
+int loadSnapshot(AuctionTable *table, const std::string &path);
+
+// Background thread of the UDP listener that saves a snapshot every interval
+class SnapshotWriter {
+  public:
+    void start(AuctionTable *table, const std::string &path,
+               uint32_t intervalSecs);
+    void stop();
+    ~SnapshotWriter();
+
+  private:
+    std::mutex lock;
+    std::condition_variable wakeUp;
+    bool running = false;
+    std::thread writer;
+};
+
+extern AuctionTable *auctionTable;
+
+#endif // __TABLE_HPP__
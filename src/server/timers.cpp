@@ -0,0 +1,32 @@
+#include "timers.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+static bool laterDeadline(const Timer &a, const Timer &b) {
+    return a.deadline > b.deadline;
+}
+
+void TimerHeap::push(uint64_t deadline, int fd, uint64_t connID) {
+    this->heap.push_back({deadline, fd, connID});
+    std::push_heap(this->heap.begin(), this->heap.end(), laterDeadline);
+}
+
+void TimerHeap::pop() {
+    std::pop_heap(this->heap.begin(), this->heap.end(), laterDeadline);
+    this->heap.pop_back();
+}
+
+int64_t TimerHeap::timeout(uint64_t now) {
+    if (this->heap.empty()) {
+        return -1;
+    }
+    uint64_t deadline = this->heap.front().deadline;
+    return deadline > now ? (int64_t)(deadline - now) : 0;
+}
+
+uint64_t monotonicMillis() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
@@ -0,0 +1,30 @@
+#ifndef __TIMERS_HPP__
+#define __TIMERS_HPP__
+
+#include <cstdint>
+#include <vector>
+
+typedef struct {
+    uint64_t deadline; // monotonic milliseconds
+    int fd;
+    uint64_t connID; // tells apart connections that reused the same fd
+} Timer;
+
+// Min-heap of deadlines. Timers are never removed early: the owner checks
+// whether a popped timer still belongs to a live connection.
+class TimerHeap {
+  public:
+    void push(uint64_t deadline, int fd, uint64_t connID);
+    void pop();
+    const Timer &top() { return heap.front(); }
+    bool empty() { return heap.empty(); }
+    // milliseconds until the earliest deadline, or -1 if there is none
+    int64_t timeout(uint64_t now);
+
+  private:
+    std::vector<Timer> heap;
+};
+
+uint64_t monotonicMillis();
+
+#endif // __TIMERS_HPP__
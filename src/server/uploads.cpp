@@ -0,0 +1,160 @@
+#include "uploads.hpp"
+#include "../lib/constants.hpp"
+#include "../lib/utils.hpp"
+
+#include <algorithm>
+#include <fcntl.h>
+#include <filesystem>
+#include <iterator>
+#include <unistd.h>
+#include <vector>
+
+UploadTable::~UploadTable() {
+    while (!this->uploads.empty()) {
+        this->remove(this->uploads.begin()->first);
+    }
+}
+
+uint32_t UploadTable::begin(uint32_t UID, uint32_t size, uint64_t now) {
+    this->expire(now);
+    if (this->uploads.size() >= MAX_UPLOADS) {
+        return 0;
+    }
+    std::uniform_int_distribution<uint32_t> tokens(1, 99999999);
+    uint32_t token;
+    do {
+        token = tokens(this->rng);
+    } while (this->uploads.count(token) != 0);
+
+    std::string path = stagingPath(token);
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1) {
+        return 0;
+    }
+    // Reserves the blocks now, so that no chunk fails for lack of space
+    if (posix_fallocate(fd, 0, (off_t)size) != 0) {
+        close(fd);
+        unlink(path.c_str());
+        return 0;
+    }
+    Upload &upload = this->uploads[token];
+    upload.UID = UID;
+    upload.size = size;
+    upload.fd = fd;
+    upload.expires = now + UPLOAD_TIMEOUT_SECS * 1000;
+    return token;
+}
+
+Upload *UploadTable::find(uint32_t token, uint64_t now) {
+    this->expire(now);
+    auto it = this->uploads.find(token);
+    if (it == this->uploads.end()) {
+        return NULL;
+    }
+    it->second.expires = now + UPLOAD_TIMEOUT_SECS * 1000;
+    return &it->second;
+}
+
+void UploadTable::received(Upload &upload, uint32_t offset, uint32_t length) {
+    uint32_t start = offset;
+    uint32_t end = offset + length;
+    // Merges the ranges it touches, so that a chunk sent twice counts once
+    auto it = upload.received.upper_bound(start);
+    if (it != upload.received.begin() && std::prev(it)->second >= start) {
+        --it;
+    }
+    while (it != upload.received.end() && it->first <= end) {
+        start = std::min(start, it->first);
+        end = std::max(end, it->second);
+        it = upload.received.erase(it);
+    }
+    upload.received[start] = end;
+}
+
+void UploadTable::forget(Upload &upload, uint32_t offset, uint32_t length) {
+    uint32_t end = offset + length;
+    auto it = upload.received.upper_bound(offset);
+    if (it != upload.received.begin() && std::prev(it)->second > offset) {
+        --it;
+    }
+    // Keeps the parts of the ranges it touches that lie outside the chunk
+    while (it != upload.received.end() && it->first < end) {
+        uint32_t rangeStart = it->first, rangeEnd = it->second;
+        it = upload.received.erase(it);
+        if (rangeStart < offset) {
+            upload.received[rangeStart] = offset;
+        }
+        if (rangeEnd > end) {
+            upload.received[end] = rangeEnd;
+        }
+    }
+}
+
+bool UploadTable::complete(const Upload &upload) {
+    return upload.received.size() == 1 &&
+           upload.received.begin()->first == 0 &&
+           upload.received.begin()->second == upload.size;
+}
+
+Chunk *UploadTable::chunk(int fd) {
+    auto it = this->chunks.find(fd);
+    return it == this->chunks.end() ? NULL : &it->second;
+}
+
+void UploadTable::startChunk(int fd, const Chunk &chunk) {
+    this->chunks[fd] = chunk;
+}
+
+void UploadTable::endChunk(int fd) { this->chunks.erase(fd); }
+
+bool UploadTable::overlapsChunk(uint32_t token, uint32_t offset,
+                                uint32_t length) {
+    for (const auto &[fd, chunk] : this->chunks) {
+        const UPCPacket &other = chunk.packet;
+        if (chunk.write && other.token == token &&
+            other.offset < offset + length &&
+            offset < other.offset + other.length) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void UploadTable::finish(uint32_t token) {
+    auto it = this->uploads.find(token);
+    if (it != this->uploads.end()) {
+        close(it->second.fd);
+        this->uploads.erase(it);
+    }
+}
+
+std::string UploadTable::stagingPath(uint32_t token) {
+    return UPLOAD_STAGING_PREFIX + toDigits(token, UPLOAD_TOKEN_LEN);
+}
+
+void UploadTable::removeStale() {
+    std::error_code err;
+    for (const auto &entry : std::filesystem::directory_iterator(".", err)) {
+        if (entry.path().filename().string().rfind(UPLOAD_STAGING_PREFIX, 0) ==
+            0) {
+            std::filesystem::remove(entry.path(), err);
+        }
+    }
+}
+
+void UploadTable::remove(uint32_t token) {
+    this->finish(token);
+    unlink(stagingPath(token).c_str());
+}
+
+void UploadTable::expire(uint64_t now) {
+    std::vector<uint32_t> expired;
+    for (auto &[token, upload] : this->uploads) {
+        if (upload.expires <= now) {
+            expired.push_back(token);
+        }
+    }
+    for (uint32_t token : expired) {
+        this->remove(token);
+    }
+}
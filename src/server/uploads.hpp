@@ -0,0 +1,70 @@
+#ifndef __UPLOADS_HPP__
+#define __UPLOADS_HPP__
+
+#include "../lib/protocol.hpp"
+
+#include <cstdint>
+#include <map>
+#include <random>
+#include <string>
+#include <unordered_map>
+
+typedef struct {
+    uint32_t UID;
+    uint32_t size;
+    int fd; // of the staging file, allocated to the size of the asset
+    std::map<uint32_t, uint32_t> received; // verified ranges, start to end
+    uint64_t expires;                      // monotonic milliseconds
+} Upload;
+
+// A chunk whose data is still arriving
+typedef struct {
+    UPCPacket packet;  // what came before the data
+    uint32_t done;     // bytes of the data read so far
+    uint32_t received; // CRC-32 of those bytes
+    bool write;        // false for a refused chunk, which is only read
+} Chunk;
+
+// Assets sent in chunks, over many connections, before their auction is
+// opened. Each one is written into a staging file in the data base with
+// pwrite(), so the chunks can arrive in any order. Only the TCP listener,
+// which opens the auctions, uses it. The data of a chunk is read as select()
+// finds it, so that a chunk does not hold up the other connections.
+class UploadTable {
+  public:
+    ~UploadTable();
+    // Returns the token of the new upload, or 0 if there are too many or the
+    // staging file could not be made
+    uint32_t begin(uint32_t UID, uint32_t size, uint64_t now);
+    // NULL if there is no such upload, or it expired
+    Upload *find(uint32_t token, uint64_t now);
+    // Marks a chunk whose checksum matched as received
+    void received(Upload &upload, uint32_t offset, uint32_t length);
+    // Unmarks the range a chunk is about to be written over, since the data
+    // there is only known to be right once its checksum matches again
+    void forget(Upload &upload, uint32_t offset, uint32_t length);
+    bool complete(const Upload &upload);
+    // The chunk arriving on the connection, NULL if there is none
+    Chunk *chunk(int fd);
+    void startChunk(int fd, const Chunk &chunk);
+    void endChunk(int fd);
+    // Whether a chunk of the upload that is still arriving overlaps the range,
+    // since the two would write over each other
+    bool overlapsChunk(uint32_t token, uint32_t offset, uint32_t length);
+    // Closes the upload, leaving its staging file for the auction to take
+    void finish(uint32_t token);
+    static std::string stagingPath(uint32_t token);
+    // Removes the staging files a crash left in the data base, before any
+    // upload begins
+    static void removeStale();
+
+  private:
+    std::unordered_map<uint32_t, Upload> uploads; // by token
+    std::unordered_map<int, Chunk> chunks;        // by fd of the connection
+    std::mt19937 rng{std::random_device{}()};     // tokens are not guessable
+
+    void remove(uint32_t token); // and its staging file
+    void expire(uint64_t now);
+};
+
+#endif // __UPLOADS_HPP__
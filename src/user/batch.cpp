@@ -0,0 +1,412 @@
+#include "batch.hpp"
+#include "../lib/messages.hpp"
+#include "../lib/utils.hpp"
+#include "commands.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <netdb.h>
+#include <sstream>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define BATCH_EVENTS (64) // handled per call to epoll_wait
+#define TCP_REPLY_LEN (16) // RBD and RCL replies
+
+static int64_t microsSince(BatchClock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               BatchClock::now() - start)
+        .count();
+}
+
+static double toMillis(int64_t micros) { return (double)micros / 1000; }
+
+// The packet id and the status, or the whole line of an ERR
+static std::string replyStatus(const std::string &response) {
+    std::string line = response.substr(0, response.find('\n'));
+    std::string status = readToken(line);
+    std::string second = readToken(line);
+    if (!second.empty()) {
+        status += " " + second;
+    }
+    return status.empty() ? "empty reply" : status;
+}
+
+static std::string jsonString(const std::string &str) {
+    std::string escaped = "\"";
+    for (char c : str) {
+        if (c == '"' || c == '\\') {
+            escaped.push_back('\\');
+            escaped.push_back(c);
+        } else if (c == '\n') {
+            escaped += "\\n";
+        } else if ((unsigned char)c < 0x20) {
+            char hex[8];
+            snprintf(hex, sizeof(hex), "\\u%04x", (unsigned char)c);
+            escaped += hex;
+        } else {
+            escaped.push_back(c);
+        }
+    }
+    return escaped + "\"";
+}
+
+Batch::~Batch() {
+    if (this->json) {
+        std::cout.rdbuf(this->results.rdbuf());
+        std::cerr.rdbuf(this->errors);
+    }
+    for (auto &entry : this->inFlight) {
+        close(entry.first);
+    }
+    if (this->epollFD != -1) {
+        close(this->epollFD);
+    }
+}
+
+int Batch::run(const std::string &path, size_t parallelism) {
+    std::ifstream file;
+    if (path != "-") {
+        file.open(path);
+        if (!file.is_open()) {
+            std::cerr << BATCH_FILE_ERR << path << std::endl;
+            return 1;
+        }
+    }
+    std::istream &script = path == "-" ? std::cin : file;
+    if ((this->epollFD = epoll_create1(EPOLL_CLOEXEC)) == -1) {
+        std::cerr << EPOLL_ERR << strerror(errno) << std::endl;
+        return 1;
+    }
+    if (this->json) {
+        // Whatever the commands print goes in the output of their result
+        std::cout.rdbuf(this->captured.rdbuf());
+        this->errors = std::cerr.rdbuf(this->captured.rdbuf());
+    }
+
+    BatchClock::time_point start = BatchClock::now();
+    size_t lineNum = 0;
+    std::string command;
+    while (!this->state.shutDown && std::getline(script, command)) {
+        ++lineNum;
+        std::string line = command;
+        std::string name = readToken(line);
+        if (name.empty() || name.front() == '#') {
+            continue; // blank line or comment
+        }
+        this->drain(parallelism - 1);
+        if (this->submit(lineNum, command)) {
+            continue;
+        }
+
+        // Commands that change the user, or that are too long to interleave
+        this->drain(0);
+        BatchClock::time_point begin = BatchClock::now();
+        this->state.line = command;
+        interpretCommand(this->state);
+        int64_t micros = microsSince(begin);
+        this->latencies.push_back(micros);
+        this->report(lineNum, command, "done", micros);
+    }
+    this->drain(0);
+    if (this->state.loggedIn) {
+        logoutHandler(this->state);
+    }
+
+    int64_t total = microsSince(start);
+    size_t count = this->latencies.size();
+    if (count == 0 && !this->json) {
+        this->results << BATCH_EMPTY << std::endl;
+        return 0;
+    }
+    std::sort(this->latencies.begin(), this->latencies.end());
+    double p50 = count ? toMillis(this->latencies[count / 2]) : 0;
+    double p99 = count ? toMillis(this->latencies[count * 99 / 100]) : 0;
+    double max = count ? toMillis(this->latencies.back()) : 0;
+    if (this->json) {
+        this->results << "{\"commands\":" << count
+                      << ",\"failed\":" << this->failed
+                      << ",\"ms\":" << toMillis(total) << ",\"p50\":" << p50
+                      << ",\"p99\":" << p99 << ",\"max\":" << max << "}"
+                      << std::endl;
+    } else {
+        this->results << BATCH_SUMMARY(count, this->failed, toMillis(total),
+                                       p50, p99, max)
+                      << std::endl;
+    }
+    return 0;
+}
+
+int Batch::submit(size_t lineNum, const std::string &command) {
+    std::string line = command;
+    std::string name = readToken(line);
+    BatchRequest request;
+    request.lineNum = lineNum;
+    request.command = command;
+    request.overTCP = false;
+    request.connected = false;
+    request.timeout = this->state.rto;
+    request.attempt = 0;
+    request.start = BatchClock::now();
+
+    bool needsLogin = false;
+    bool valid = true;
+    if (name == "list" || name == "l") {
+        request.request = LSTPacket().serialize();
+        request.lim = RLS_LEN;
+    } else if (name == "stats") {
+        request.request = STAPacket().serialize();
+        request.lim = RST_LEN;
+    } else if (name == "show_record" || name == "sr") {
+        SRCPacket packetOut;
+        packetOut.AID = readToken(line);
+        valid = !checkAID(packetOut.AID);
+        request.request = packetOut.serialize();
+        request.lim = RRC_LEN;
+    } else if (name == "myauctions" || name == "ma") {
+        LMAPacket packetOut;
+        packetOut.UID = this->state.UID;
+        needsLogin = true;
+        request.request = packetOut.serialize();
+        request.lim = RMA_LEN;
+    } else if (name == "mybids" || name == "mb") {
+        LMBPacket packetOut;
+        packetOut.UID = this->state.UID;
+        needsLogin = true;
+        request.request = packetOut.serialize();
+        request.lim = RMB_LEN;
+    } else if (name == "bid" || name == "b") {
+        BIDPacket packetOut;
+        packetOut.UID = this->state.UID;
+        packetOut.password = this->state.password;
+        packetOut.AID = readToken(line);
+        needsLogin = true;
+        if ((valid = !checkAID(packetOut.AID)) &&
+            toInt(readToken(line), packetOut.value, MAX_VAL_DIGS, MAX_VAL)) {
+            std::cerr << VAL_ERR << std::endl;
+            valid = false;
+        }
+        request.overTCP = true;
+        request.request = packetOut.message();
+        request.lim = TCP_REPLY_LEN;
+    } else if (name == "close") {
+        CLSPacket packetOut;
+        packetOut.UID = this->state.UID;
+        packetOut.password = this->state.password;
+        packetOut.AID = readToken(line);
+        needsLogin = true;
+        valid = !checkAID(packetOut.AID);
+        request.overTCP = true;
+        request.request = packetOut.message();
+        request.lim = TCP_REPLY_LEN;
+    } else {
+        return 0;
+    }
+    if (needsLogin && !this->state.loggedIn) {
+        std::cerr << NO_LOGIN << std::endl;
+        valid = false;
+    }
+    if (!valid) {
+        this->reject(request, "invalid");
+        return 1;
+    }
+
+    const struct addrinfo *addr =
+        request.overTCP ? this->state.addrTCP : this->state.addrUDP;
+    int fd = socket(AF_INET,
+                    (request.overTCP ? SOCK_STREAM : SOCK_DGRAM) |
+                        SOCK_NONBLOCK | SOCK_CLOEXEC,
+                    0);
+    if (fd == -1) {
+        std::cerr << SOCKET_CREATE_ERR << strerror(errno) << std::endl;
+        this->reject(request, "no socket");
+        return 1;
+    }
+    // A connected UDP socket only takes datagrams from the server, so
+    // whatever arrives on it is the reply to this request
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = request.overTCP ? EPOLLOUT : EPOLLIN;
+    event.data.fd = fd;
+    if ((connect(fd, addr->ai_addr, addr->ai_addrlen) == -1 &&
+         errno != EINPROGRESS) ||
+        epoll_ctl(this->epollFD, EPOLL_CTL_ADD, fd, &event) == -1) {
+        close(fd);
+        std::cerr << (request.overTCP ? TCP_CONNECT_ERR : SENDTO_ERR)
+                  << std::endl;
+        this->reject(request, "not sent");
+        return 1;
+    }
+    if (request.overTCP) {
+        request.deadline =
+            request.start + std::chrono::seconds(READ_TIMEOUT_SECS);
+    }
+    BatchRequest &stored = this->inFlight[fd] = std::move(request);
+    if (!stored.overTCP && this->sendUDP(fd, stored)) {
+        this->finish(fd, "not sent", false);
+    }
+    return 1;
+}
+
+int Batch::sendUDP(int fd, BatchRequest &request) {
+    if (send(fd, request.request.c_str(), request.request.length(), 0) == -1) {
+        return 1;
+    }
+    std::uniform_int_distribution<uint32_t> jitter(
+        request.timeout - request.timeout / 4,
+        request.timeout + request.timeout / 4);
+    request.deadline =
+        BatchClock::now() + std::chrono::milliseconds(jitter(this->state.rng));
+    return 0;
+}
+
+void Batch::handle(int fd, uint32_t events) {
+    BatchRequest &request = this->inFlight[fd];
+    if (request.overTCP && !request.connected) {
+        int err = 0;
+        socklen_t len = sizeof(err);
+        if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) == -1 ||
+            err != 0) {
+            this->finish(fd, "not connected", false);
+            return;
+        }
+        if (send(fd, request.request.c_str(), request.request.length(),
+                 MSG_NOSIGNAL) != (ssize_t)request.request.length()) {
+            this->finish(fd, "not sent", false);
+            return;
+        }
+        struct epoll_event event;
+        memset(&event, 0, sizeof(event));
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        epoll_ctl(this->epollFD, EPOLL_CTL_MOD, fd, &event);
+        request.connected = true;
+        return;
+    }
+    (void)events; // read errors are reported by recv
+
+    char buffer[RST_LEN + 1];
+    ssize_t n = recv(fd, buffer, std::min(request.lim + 1, sizeof(buffer)), 0);
+    if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        return;
+    } else if (n == -1) {
+        // A UDP request to a port no one listens on is refused
+        this->finish(fd, errno == ECONNREFUSED ? "refused" : "not received",
+                     false);
+        return;
+    } else if (n == 0) {
+        this->finish(fd, request.response.empty() ? "closed" : request.response,
+                     !request.response.empty());
+        return;
+    }
+    request.response.append(buffer, (size_t)n);
+    if (!request.overTCP || request.response.find('\n') != std::string::npos ||
+        request.response.length() > request.lim) {
+        this->finish(fd, request.response, true);
+    }
+}
+
+void Batch::drain(size_t maxInFlight) {
+    struct epoll_event events[BATCH_EVENTS];
+    while (this->inFlight.size() > maxInFlight) {
+        if (this->state.shutDown) {
+            while (!this->inFlight.empty()) {
+                this->finish(this->inFlight.begin()->first, "interrupted",
+                             false);
+            }
+            return;
+        }
+        BatchClock::time_point next = BatchClock::time_point::max();
+        for (auto &entry : this->inFlight) {
+            next = std::min(next, entry.second.deadline);
+        }
+        int64_t wait = std::chrono::duration_cast<std::chrono::milliseconds>(
+                           next - BatchClock::now())
+                           .count();
+        int ready = epoll_wait(this->epollFD, events, BATCH_EVENTS,
+                               (int)std::max(wait + 1, (int64_t)0));
+        if (ready == -1 && errno != EINTR) {
+            std::cerr << EPOLL_ERR << strerror(errno) << std::endl;
+            this->state.shutDown = true;
+            continue;
+        }
+        for (int i = 0; i < ready; ++i) {
+            if (this->inFlight.count(events[i].data.fd)) {
+                this->handle(events[i].data.fd, events[i].events);
+            }
+        }
+
+        // Lost UDP requests are sent again, with the same backoff as the
+        // interactive commands
+        BatchClock::time_point now = BatchClock::now();
+        std::vector<int> expired;
+        for (auto &entry : this->inFlight) {
+            if (entry.second.deadline <= now) {
+                expired.push_back(entry.first);
+            }
+        }
+        for (int fd : expired) {
+            BatchRequest &request = this->inFlight[fd];
+            if (request.overTCP || request.attempt >= this->state.retries) {
+                this->finish(fd, "timeout", false);
+                continue;
+            }
+            request.attempt++;
+            request.timeout =
+                std::min(request.timeout * 2,
+                         std::max(this->state.rto, UDP_MAX_RTO_MS));
+            if (this->sendUDP(fd, request)) {
+                this->finish(fd, "not sent", false);
+            }
+        }
+    }
+}
+
+void Batch::finish(int fd, const std::string &status, bool answered) {
+    BatchRequest &request = this->inFlight[fd];
+    if (answered) {
+        int64_t micros = microsSince(request.start);
+        this->latencies.push_back(micros);
+        this->report(request.lineNum, request.command, replyStatus(status),
+                     micros, status);
+    } else {
+        this->reject(request, status);
+    }
+    close(fd);
+    this->inFlight.erase(fd);
+}
+
+void Batch::reject(const BatchRequest &request, const std::string &reason) {
+    int64_t micros = microsSince(request.start);
+    this->latencies.push_back(micros);
+    this->failed++;
+    this->report(request.lineNum, request.command, reason, micros);
+}
+
+void Batch::report(size_t lineNum, const std::string &command,
+                   const std::string &status, int64_t micros,
+                   const std::string &reply) {
+    if (!this->json) {
+        this->results << BATCH_RESULT(lineNum, command, status,
+                                      toMillis(micros))
+                      << '\n';
+        return;
+    }
+    this->results << "{\"line\":" << lineNum
+                  << ",\"command\":" << jsonString(command)
+                  << ",\"status\":" << jsonString(status)
+                  << ",\"ms\":" << toMillis(micros);
+    if (!reply.empty()) {
+        this->results << ",\"reply\":"
+                      << jsonString(reply.substr(0, reply.find('\n')));
+    }
+    std::string output = this->captured.str();
+    if (!output.empty()) {
+        this->results << ",\"output\":" << jsonString(output);
+        this->captured.str("");
+    }
+    this->results << "}\n";
+}
@@ -0,0 +1,73 @@
+#ifndef __BATCH_HPP__
+#define __BATCH_HPP__
+
+#include "user_state.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+typedef std::chrono::steady_clock BatchClock;
+
+typedef struct {
+    size_t lineNum;
+    std::string command; // as written in the script
+    bool overTCP;
+    bool connected; // TCP only, the request was sent
+    std::string request;
+    size_t lim; // longest reply expected
+    std::string response;
+    uint32_t timeout; // current wait for a UDP reply
+    uint32_t attempt;
+    BatchClock::time_point start;
+    BatchClock::time_point deadline; // of the current attempt
+} BatchRequest;
+
+// Runs the commands of a script with many requests in flight at a time. The
+// UDP queries and the TCP bids and closes each get a socket of their own, so
+// replies are matched to requests by the port they arrive on, and are waited
+// for together with epoll. Every other command waits for the ones in flight
+// and then runs as if it was typed.
+// With json, the result of each command is printed as a JSON object on a line
+// of its own, with what the command printed in it, and nothing else is.
+class Batch {
+  public:
+    Batch(UserState &userState, bool asJSON)
+        : state(userState), json(asJSON) {}
+    ~Batch();
+    // Reads the script from the standard input if path is "-". Returns 1 if
+    // the script could not be read.
+    int run(const std::string &path, size_t parallelism);
+
+  private:
+    UserState &state;
+    bool json;
+    // Results are buffered, and only flushed at the end or when full
+    std::ostream results{std::cout.rdbuf()};
+    std::ostringstream captured;       // printed by the commands, with json
+    std::streambuf *errors = NULL;     // of std::cerr, while captured
+    int epollFD = -1;
+    std::unordered_map<int, BatchRequest> inFlight; // by socket
+    std::vector<int64_t> latencies;                 // microseconds
+    size_t failed = 0;
+
+    // Returns 0 if the command does not go through the batch, and 1 if it was
+    // either sent or rejected
+    int submit(size_t lineNum, const std::string &command);
+    int sendUDP(int fd, BatchRequest &request);
+    void handle(int fd, uint32_t events);
+    // Waits until at most maxInFlight requests are left
+    void drain(size_t maxInFlight);
+    // Reports the reply, or why there was none, and closes the socket
+    void finish(int fd, const std::string &status, bool answered);
+    // Reports a request that got no reply, or was never sent
+    void reject(const BatchRequest &request, const std::string &reason);
+    void report(size_t lineNum, const std::string &command,
+                const std::string &status, int64_t micros,
+                const std::string &reply = "");
+};
+
+#endif // __BATCH_HPP__
@@ -2,7 +2,15 @@
 #include "../lib/messages.hpp"
 #include "../lib/utils.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <fcntl.h>
+#include <filesystem>
 #include <iostream>
+#include <sys/select.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
 
 CommandsHandler handler = {{"login", loginHandler},
                            {"logout", logoutHandler},
@@ -16,12 +24,19 @@ CommandsHandler handler = {{"login", loginHandler},
                            {"mb", myBidsHandler},
                            {"list", listHandler},
                            {"l", listHandler},
+                           {"list_pages", listPagesHandler},
+                           {"lp", listPagesHandler},
+                           {"list_filter", listFilterHandler},
+                           {"lf", listFilterHandler},
                            {"show_asset", showAssetHandler},
                            {"sa", showAssetHandler},
                            {"bid", bidHandler},
                            {"b", bidHandler},
                            {"show_record", showRecordHandler},
                            {"sr", showRecordHandler},
+                           {"watch", watchHandler},
+                           {"w", watchHandler},
+                           {"stats", statsHandler},
                            {"help", helpHandler}};
 
 std::string readToken(std::string &line) {
@@ -80,7 +95,16 @@ void helpHandler(UserState &state) {
               << "Lists the auctions bidded on by the currently logged in user."
               << std::endl;
     std::cout << "  - list (l)\t\t"
-              << "Lists the currently active auctions." << std::endl
+              << "Lists the currently active auctions." << std::endl;
+    std::cout << "  - list_pages (lp) [active]\t"
+              << "Lists the auctions a page at a time, only the active ones "
+                 "if asked."
+              << std::endl;
+    std::cout << "  - list_filter (lf) active | range <AID> <AID> | ending "
+                 "<seconds>\t"
+              << "Lists the active auctions, the ones in a range of ids, or "
+                 "the ones ending soonest."
+              << std::endl
               << std::endl;
 
     std::cout
@@ -91,6 +115,15 @@ void helpHandler(UserState &state) {
               << "Bids on the specified auction." << std::endl;
     std::cout << "  - show_record (sr) <AID>\t"
               << "Presents information about the specified auction."
+              << std::endl;
+    std::cout << "  - watch (w) [AID]\t\t"
+              << "Prints the bids, openings and closings of the auctions (or "
+                 "only of the specified one) as they happen."
+              << std::endl
+              << std::endl;
+
+    std::cout << "  - stats\t\t\t"
+              << "Shows the metrics of a server running on this machine."
               << std::endl
               << std::endl;
 
@@ -209,26 +242,47 @@ void openHandler(UserState &state) {
         return;
     }
     uint32_t startValue;
-    if (toInt(readToken(state.line), startValue) || startValue >= MAX_VAL) {
+    if (toInt(readToken(state.line), startValue, MAX_VAL_DIGS, MAX_VAL - 1)) {
         std::cerr << START_VAL_ERR << std::endl;
         return;
     }
     uint32_t duration;
-    if (toInt(readToken(state.line), duration) || duration > MAX_DURATION) {
+    if (toInt(readToken(state.line), duration, MAX_DURATION_DIGS,
+              MAX_DURATION)) {
         std::cerr << DURATION_ERR << std::endl;
         return;
     }
 
-    OPAPacket packetOut;
-    packetOut.UID = state.UID;
-    packetOut.password = state.password;
-    packetOut.auctionName = auctionName;
-    packetOut.assetfPath = fPath;
-    packetOut.startValue = startValue;
-    packetOut.duration = duration;
     ROAPacket packetIn;
-    if (state.sendAndReceiveTCPPacket(packetOut, packetIn)) {
-        return;
+    std::error_code err;
+    uintmax_t fSize = std::filesystem::file_size(fPath, err);
+    if (!err && fSize > UPLOAD_CHUNK_SIZE && fSize <= MAX_FILE_SIZE) {
+        uint32_t token;
+        if (uploadAsset(state, fPath, (uint32_t)fSize, token)) {
+            return;
+        }
+        OPCPacket packetOut;
+        packetOut.UID = state.UID;
+        packetOut.password = state.password;
+        packetOut.auctionName = auctionName;
+        packetOut.startValue = startValue;
+        packetOut.duration = duration;
+        packetOut.assetfName = std::filesystem::path(fPath).filename();
+        packetOut.token = token;
+        if (state.sendAndReceiveTCPPacket(packetOut, packetIn)) {
+            return;
+        }
+    } else {
+        OPAPacket packetOut;
+        packetOut.UID = state.UID;
+        packetOut.password = state.password;
+        packetOut.auctionName = auctionName;
+        packetOut.assetfPath = fPath;
+        packetOut.startValue = startValue;
+        packetOut.duration = duration;
+        if (state.sendAndReceiveTCPPacket(packetOut, packetIn)) {
+            return;
+        }
     }
 
     if (packetIn.status == "OK") {
@@ -242,6 +296,86 @@ void openHandler(UserState &state) {
     }
 }
 
+// Sends an asset too big for a single OPA in chunks, UPLOAD_STREAMS of them at
+// a time over connections of their own, each with the CRC-32 of its data. A
+// chunk that is lost or arrives corrupted is sent again, a few times at most.
+int uploadAsset(UserState &state, const std::string &fPath, uint32_t fSize,
+                uint32_t &token) {
+    UPSPacket startOut;
+    startOut.UID = state.UID;
+    startOut.password = state.password;
+    startOut.assetfSize = fSize;
+    RUSPacket startIn;
+    if (state.sendAndReceiveTCPPacket(startOut, startIn)) {
+        return 1;
+    }
+    if (startIn.status == "NLG") {
+        std::cerr << NOT_LOGGED << std::endl;
+        return 1;
+    } else if (startIn.status != "OK") {
+        std::cerr << UPLOAD_NOK << std::endl;
+        return 1;
+    }
+    token = startIn.token;
+
+    int file = open(fPath.c_str(), O_RDONLY);
+    if (file == -1) {
+        std::cerr << FILE_ERR << std::endl;
+        return 1;
+    }
+    uint32_t chunks = (fSize + UPLOAD_CHUNK_SIZE - 1) / UPLOAD_CHUNK_SIZE;
+    std::atomic<uint32_t> next{0};
+    std::atomic<bool> failed{false};
+    std::atomic<bool> dropped{false}; // the server no longer has the upload
+    auto stream = [&]() {
+        UPCPacket chunkOut;
+        chunkOut.token = token;
+        RUCPacket chunkIn;
+        uint32_t chunk;
+        while (!failed && (chunk = next++) < chunks) {
+            chunkOut.offset = chunk * UPLOAD_CHUNK_SIZE;
+            chunkOut.length =
+                std::min<uint32_t>(UPLOAD_CHUNK_SIZE, fSize - chunkOut.offset);
+            chunkOut.data.resize(chunkOut.length);
+            if (pread(file, chunkOut.data.data(), chunkOut.length,
+                      (off_t)chunkOut.offset) != (ssize_t)chunkOut.length) {
+                failed = true;
+                break;
+            }
+            chunkOut.crc = crc32(chunkOut.data.data(), chunkOut.length);
+            int res;
+            uint32_t attempt = 0;
+            while (((res = state.exchangeTCPPacket(chunkOut, chunkIn)) ||
+                    chunkIn.status == "CRC") &&
+                   attempt++ < UPLOAD_RETRIES) {
+            }
+            if (!res && chunkIn.status == "NOK") {
+                dropped = true;
+            }
+            if (res || chunkIn.status != "OK") {
+                failed = true;
+            }
+        }
+    };
+
+    std::cout << UPLOAD_PROGRESS;
+    std::vector<std::thread> streams;
+    for (uint32_t i = 0; i < std::min<uint32_t>(UPLOAD_STREAMS, chunks); i++) {
+        streams.emplace_back(stream);
+    }
+    for (std::thread &t : streams) {
+        t.join();
+    }
+    close(file);
+    if (failed) {
+        std::cout << std::endl;
+        std::cerr << (dropped ? UPLOAD_DROPPED : UPLOAD_CHUNK_ERR) << std::endl;
+        return 1;
+    }
+    std::cout << " 100%" << std::endl;
+    return 0;
+}
+
 void closeHandler(UserState &state) {
     if (!state.loggedIn) {
         std::cerr << NO_LOGIN << std::endl;
@@ -343,20 +477,143 @@ void listHandler(UserState &state) {
     }
 }
 
+void listPagesHandler(UserState &state) {
+    std::string filter = readToken(state.line);
+    if (!filter.empty() && filter != "active") {
+        std::cerr << LIST_FILTER_ERR << std::endl;
+        return;
+    }
+
+    LPGPacket packetOut;
+    packetOut.activeOnly = !filter.empty();
+    do {
+        RLPPacket packetIn;
+        if (state.sendAndReceiveUDPPacket(packetOut, packetIn, RLP_LEN)) {
+            return;
+        }
+
+        if (packetIn.status == "OK") {
+            if (packetOut.cursor == 0) {
+                std::cout << LIST_OK << std::endl;
+            }
+            listAuctions(packetIn.auctions);
+            packetOut.cursor = packetIn.next;
+        } else if (packetIn.status == "NOK") {
+            if (packetOut.cursor == 0 && packetOut.activeOnly) {
+                std::cerr << LIST_ACTIVE_NOK << std::endl;
+            } else if (packetOut.cursor == 0) {
+                std::cerr << LIST_NOK << std::endl;
+            }
+            return; // the rest of the auctions were not active
+        } else {
+            std::cerr << PACKET_ERR << std::endl;
+            return;
+        }
+    } while (packetOut.cursor != 0);
+}
+
+void listFilterHandler(UserState &state) {
+    std::string filter = readToken(state.line);
+    LFLPacket packetOut;
+    if (filter == "active") {
+        packetOut.filter = FILTER_ACTIVE;
+    } else if (filter == "range") {
+        std::string from = readToken(state.line);
+        std::string to = readToken(state.line);
+        if (checkAID(from) || checkAID(to)) {
+            return;
+        }
+        toInt(from, packetOut.from);
+        toInt(to, packetOut.to);
+        if (packetOut.from == 0 || packetOut.from > packetOut.to) {
+            std::cerr << LIST_RANGE_ERR << std::endl;
+            return;
+        }
+        packetOut.filter = FILTER_RANGE;
+    } else if (filter == "ending") {
+        if (toInt(readToken(state.line), packetOut.within, MAX_DURATION_DIGS,
+                  MAX_DURATION) ||
+            packetOut.within == 0) {
+            std::cerr << LIST_ENDING_ERR << std::endl;
+            return;
+        }
+        packetOut.filter = FILTER_ENDING;
+    } else {
+        std::cerr << FILTER_ERR << std::endl;
+        return;
+    }
+
+    RLFPacket packetIn;
+    if (state.sendAndReceiveUDPPacket(packetOut, packetIn, RLF_LEN)) {
+        return;
+    }
+
+    if (packetIn.status == "OK") {
+        std::cout << LIST_OK << std::endl;
+        listAuctions(packetIn.auctions);
+    } else if (packetIn.status == "NOK") {
+        if (packetOut.filter == FILTER_RANGE) {
+            std::cerr << LIST_RANGE_NOK << std::endl;
+        } else if (packetOut.filter == FILTER_ENDING) {
+            std::cerr << LIST_ENDING_NOK << std::endl;
+        } else {
+            std::cerr << LIST_ACTIVE_NOK << std::endl;
+        }
+    } else {
+        std::cerr << PACKET_ERR << std::endl;
+    }
+}
+
+// The asset is downloaded into a partial file named after the AID, so a
+// transfer that breaks is resumed from where it stopped
 void showAssetHandler(UserState &state) {
     std::string aid = readToken(state.line);
     if (checkAID(aid)) {
         return;
     }
 
-    SASPacket packetOut;
+    std::string partPath = aid + PARTIAL_ASSET_SUFFIX;
+    std::error_code err;
+    uintmax_t partSize = std::filesystem::file_size(partPath, err);
+    SARPacket packetOut;
     packetOut.AID = aid;
-    RSAPacket packetIn;
-    if (state.sendAndReceiveTCPPacket(packetOut, packetIn)) {
-        return;
+    packetOut.offset = err ? 0 : (uint32_t)std::min<uintmax_t>(partSize,
+                                                              MAX_FILE_SIZE);
+    packetOut.length = 0; // the rest of the asset
+    RSRPacket packetIn;
+    packetIn.partPath = partPath;
+    if (packetOut.offset > 0) {
+        std::cout << SHOW_ASSET_RESUMED(packetOut.offset) << std::endl;
+    }
+    while (true) {
+        if (state.sendAndReceiveTCPPacket(packetOut, packetIn)) {
+            if (std::filesystem::file_size(partPath, err) > 0 && !err) {
+                std::cerr << SHOW_ASSET_PARTIAL << std::endl;
+            }
+            return;
+        }
+        if (packetIn.status != "OK" ||
+            (packetIn.offset == packetOut.offset &&
+             std::filesystem::file_size(partPath, err) == packetIn.assetfSize &&
+             !err)) {
+            break;
+        }
+        // Left by another asset, or another server, with a different size
+        std::filesystem::remove(partPath, err);
+        if (packetOut.offset == 0) {
+            std::cerr << FILE_ERR << std::endl;
+            return;
+        }
+        std::cout << SHOW_ASSET_RESTARTED << std::endl;
+        packetOut.offset = 0;
     }
 
     if (packetIn.status == "OK") {
+        std::filesystem::rename(partPath, packetIn.assetfName, err);
+        if (err) {
+            std::cerr << FILE_ERR << std::endl;
+            return;
+        }
         std::cout << SHOW_ASSET_OK(packetIn.assetfName, packetIn.assetfSize)
                   << std::endl;
     } else if (packetIn.status == "NOK") {
@@ -376,7 +633,7 @@ void bidHandler(UserState &state) {
         return;
     }
     uint32_t value;
-    if (toInt(readToken(state.line), value) || value > MAX_VAL) {
+    if (toInt(readToken(state.line), value, MAX_VAL_DIGS, MAX_VAL)) {
         std::cerr << VAL_ERR << std::endl;
         return;
     }
@@ -406,12 +663,38 @@ void bidHandler(UserState &state) {
     }
 }
 
+// Records already shown are asked again only for the bids after the ones
+// seen, and not resent at all if nothing changed
 void showRecordHandler(UserState &state) {
     std::string aid = readToken(state.line);
     if (checkAID(aid)) {
         return;
     }
 
+    auto cached = state.records.find(aid);
+    if (cached != state.records.end()) {
+        SRDPacket packetOut;
+        packetOut.AID = aid;
+        packetOut.seq = cached->second.seq;
+        RRDPacket packetIn;
+        if (state.sendAndReceiveUDPPacket(packetOut, packetIn, RRD_LEN)) {
+            return;
+        }
+
+        if (packetIn.status == "OK") {
+            mergeRecord(cached->second, packetIn);
+            printRecord(cached->second.record);
+        } else if (packetIn.status == "UNC") {
+            printRecord(cached->second.record);
+        } else if (packetIn.status == "NOK") {
+            state.records.erase(cached);
+            std::cerr << SHOW_RECORD_NOK << std::endl;
+        } else {
+            std::cerr << PACKET_ERR << std::endl;
+        }
+        return;
+    }
+
     SRCPacket packetOut;
     packetOut.AID = aid;
     RRCPacket packetIn;
@@ -420,36 +703,145 @@ void showRecordHandler(UserState &state) {
     }
 
     if (packetIn.status == "OK") {
-        std::cout << "General information about the requested auction:"
+        printRecord(packetIn);
+        // Short by the bids that left the list, the next reply corrects it
+        uint32_t seq = (uint32_t)packetIn.bids.size();
+        state.records[aid] = {std::move(packetIn), seq};
+    } else if (packetIn.status == "NOK") {
+        std::cerr << SHOW_RECORD_NOK << std::endl;
+    } else {
+        std::cerr << PACKET_ERR << std::endl;
+    }
+}
+
+// Bid values only grow, so the ones already in the record are told apart
+// by their value
+void mergeRecord(CachedRecord &cached, RRDPacket &delta) {
+    std::vector<Bid> &bids = cached.record.bids;
+    for (const Bid &bid : delta.bids) {
+        if (bids.empty() || bid.value > bids.back().value) {
+            bids.push_back(bid);
+        }
+    }
+    if (bids.size() > MAX_BIDS_LISTINGS) {
+        bids.erase(bids.begin(), bids.end() - MAX_BIDS_LISTINGS);
+    }
+    if (!delta.calEndDate.empty()) {
+        cached.record.calEndDate = delta.calEndDate;
+        cached.record.timeEndDate = delta.timeEndDate;
+        cached.record.endSecTime = delta.endSecTime;
+    }
+    cached.seq = delta.seq;
+}
+
+void printRecord(const RRCPacket &record) {
+    std::cout << "General information about the requested auction:"
+              << std::endl;
+    std::cout << "hosted by: " << record.hostUID
+              << " | auction name: " << record.auctionName
+              << " | asset file name: " << record.assetfName
+              << " | start value: " << record.startValue << std::endl
+              << "start date time: " << record.calStartDate << " "
+              << record.timeStartDate
+              << " | maximum duration: " << record.duration << " seconds"
+              << std::endl;
+    if (!record.calEndDate.empty()) {
+        std::cout << "end date time: " << record.calEndDate << " "
+                  << record.timeEndDate
+                  << " | closed after: " << record.endSecTime << " seconds"
+                  << std::endl;
+    }
+    int i = 0;
+    for (Bid bid : record.bids) {
+        std::cout << "---------------------------------------------------------"
+                     "------"
                   << std::endl;
-        std::cout << "hosted by: " << packetIn.hostUID
-                  << " | auction name: " << packetIn.auctionName
-                  << " | asset file name: " << packetIn.assetfName
-                  << " | start value: " << packetIn.startValue << std::endl
-                  << "start date time: " << packetIn.calStartDate << " "
-                  << packetIn.timeStartDate
-                  << " | maximum duration: " << packetIn.duration << " seconds"
+        std::cout << "Bid number " << ++i << ":" << std::endl;
+        std::cout << "bid by: " << toDigits(bid.bidderUID, UID_LEN)
+                  << " | bid value: " << bid.value << std::endl
+                  << "bid date time: " << toDate(bid.time)
+                  << " | bidded after: " << bid.secTime << " seconds"
                   << std::endl;
-        if (!packetIn.calEndDate.empty()) {
-            std::cout << "end date time: " << packetIn.calEndDate << " "
-                      << packetIn.timeEndDate
-                      << " | closed after: " << packetIn.endSecTime
-                      << " seconds" << std::endl;
+    }
+}
+
+void watchHandler(UserState &state) {
+    std::string aid = readToken(state.line);
+    if (aid.empty()) {
+        aid = "000"; // every auction
+    } else if (checkAID(aid)) {
+        return;
+    }
+
+    SUBPacket packetOut;
+    packetOut.AID = aid;
+    RSBPacket packetIn;
+    if (state.sendAndReceiveTCPPacket(packetOut, packetIn, true)) {
+        return;
+    }
+
+    if (packetIn.status == "OK") {
+        std::cout << WATCH_OK << std::endl;
+        watchEvents(state);
+    } else if (packetIn.status == "NOK") {
+        std::cerr << WATCH_NOK << std::endl;
+    } else {
+        std::cerr << PACKET_ERR << std::endl;
+    }
+    state.closeTCPSocket();
+}
+
+// Prints the events the server pushes until the user presses enter
+void watchEvents(UserState &state) {
+    while (!state.shutDown && std::cin.rdbuf()->in_avail() <= 0) {
+        fd_set fds;
+        FD_ZERO(&fds);
+        FD_SET(STDIN_FILENO, &fds);
+        FD_SET(state.socketTCP, &fds);
+        if (select(state.socketTCP + 1, &fds, NULL, NULL, NULL) == -1) {
+            return; // interrupted
         }
-        int i = 0;
-        for (Bid bid : packetIn.bids) {
-            std::cout << "-----------------------------------------------------"
-                         "----------"
-                      << std::endl;
-            std::cout << "Bid number " << ++i << ":" << std::endl;
-            std::cout << "bid by: " << bid.bidderUID
-                      << " | bid value: " << bid.value << std::endl
-                      << "bid date time: " << bid.calDate << " " << bid.timeDate
-                      << " | bidded after: " << bid.secTime << " seconds"
-                      << std::endl;
+        if (FD_ISSET(state.socketTCP, &fds)) {
+            EVTPacket event;
+            if (event.deserialize(state.socketTCP)) {
+                std::cerr << WATCH_END << std::endl;
+                return;
+            }
+            std::string aid = toDigits(event.AID, AID_LEN);
+            if (event.kind == EVENT_OPENED) {
+                std::cout << EVENT_OPENED(aid, event.UID, event.value)
+                          << std::endl;
+            } else if (event.kind == EVENT_BID) {
+                std::cout << EVENT_BID(aid, event.UID, event.value)
+                          << std::endl;
+            } else {
+                std::cout << EVENT_CLOSED(aid) << std::endl;
+            }
+        }
+        if (FD_ISSET(STDIN_FILENO, &fds)) {
+            break;
+        }
+    }
+    if (!state.shutDown) {
+        std::string line;
+        std::getline(std::cin, line);
+    }
+}
+
+void statsHandler(UserState &state) {
+    STAPacket packetOut;
+    RSTPacket packetIn;
+    if (state.sendAndReceiveUDPPacket(packetOut, packetIn, RST_LEN)) {
+        return;
+    }
+
+    if (packetIn.status == "OK") {
+        std::cout << STATS_OK << std::endl;
+        for (const std::string &metric : packetIn.metrics) {
+            std::cout << "  " << metric << std::endl;
         }
     } else if (packetIn.status == "NOK") {
-        std::cerr << SHOW_RECORD_NOK << std::endl;
+        std::cerr << STATS_NOK << std::endl;
     } else {
         std::cerr << PACKET_ERR << std::endl;
     }
@@ -460,7 +852,8 @@ void showRecordHandler(UserState &state) {
 void listAuctions(std::vector<Auction> auctions) {
     std::cout << "------------------------------------------" << std::endl;
     for (Auction auction : auctions) {
-        std::cout << "Auction with id '" << auction.AID << "' --------> "
+        std::cout << "Auction with id '" << toDigits(auction.AID, AID_LEN)
+                  << "' --------> "
                   << (auction.state == 1 ? "active" : "not active")
                   << std::endl;
     }
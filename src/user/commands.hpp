@@ -22,10 +22,19 @@ void closeHandler(UserState &state);
 void myAuctionsHandler(UserState &state);
 void myBidsHandler(UserState &state);
 void listHandler(UserState &state);
+void listPagesHandler(UserState &state);
+void listFilterHandler(UserState &state);
 void showAssetHandler(UserState &state);
 void bidHandler(UserState &state);
 void showRecordHandler(UserState &state);
+void statsHandler(UserState &state);
+void watchHandler(UserState &state);
 
+int uploadAsset(UserState &state, const std::string &fPath, uint32_t fSize,
+                uint32_t &token);
 void listAuctions(std::vector<Auction> auctions);
+void mergeRecord(CachedRecord &cached, RRDPacket &delta);
+void printRecord(const RRCPacket &record);
+void watchEvents(UserState &state);
 
 #endif // __COMMANDS_HPP__
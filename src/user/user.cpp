@@ -1,5 +1,6 @@
 #include "user.hpp"
 #include "../lib/messages.hpp"
+#include "batch.hpp"
 #include "commands.hpp"
 #include "user_state.hpp"
 
@@ -13,12 +14,23 @@ int main(int argc, char *argv[]) {
     state.openUDPSocket();
     state.getServerAddresses();
 
+    if (state.json) {
+        return Batch(state, true).run(state.script, state.parallelism)
+                   ? EXIT_FAILURE
+                   : EXIT_SUCCESS;
+    }
     if (state.host.compare(DEFAULT_AS_HOST) == 0) {
         std::cout << DEFAULT_AS_HOST_STR << std::endl;
     }
     if (state.port.compare(DEFAULT_AS_PORT) == 0) {
         std::cout << DEFAULT_AS_PORT_STR << std::endl;
     }
+    if (!state.script.empty()) {
+        return Batch(state, false).run(state.script, state.parallelism)
+                   ? EXIT_FAILURE
+                   : EXIT_SUCCESS;
+    }
+
     printTitle();
     helpHandler(state);
 
@@ -48,13 +60,30 @@ void printTitle() {
 }
 
 void printHelp(std::ostream &stream, char *programPath) {
-    stream << "Usage: " << programPath << " [-n ASIP] [-p ASport] [-h]"
-           << std::endl;
+    stream << "Usage: " << programPath
+           << " [-n ASIP] [-p ASport] [-t rto] [-r retries] [-s script] "
+              "[-b script] [-j parallelism] [-h]" << std::endl;
     stream << "Available options:" << std::endl;
     stream << "-n ASIP\t\tSet hostname of Auction Server. Default is: "
            << DEFAULT_AS_HOST << std::endl;
     stream << "-p ASport\tSet port of Auction Server. Default is: "
            << DEFAULT_AS_PORT << std::endl;
+    stream << "-t rto\t\tSet how many milliseconds to wait for a UDP reply "
+              "before sending the request again, doubled on each retry. "
+              "Default is: "
+           << UDP_RTO_MS << std::endl;
+    stream << "-r retries\tSet how many times to send a UDP request again. "
+              "Default is: "
+           << UDP_RETRIES << std::endl;
+    stream << "-s script\tRun the commands in the script instead of reading "
+              "them, with many requests in flight, and print their latency."
+           << std::endl;
+    stream << "-b script\tLike -s, but print the result of each command as "
+              "a line of JSON. A script of - is read from the standard input."
+           << std::endl;
+    stream << "-j parallelism\tSet how many requests of the script can be in "
+              "flight at a time. Default is: "
+           << BATCH_PARALLELISM << std::endl;
     stream << "-h\t\tPrint this help menu." << std::endl;
 }
 
@@ -3,15 +3,18 @@
 #include "../lib/protocol.hpp"
 #include "user.hpp"
 
+#include <algorithm>
+#include <chrono>
 #include <cstring>
 #include <iostream>
 #include <netdb.h>
+#include <poll.h>
 #include <sys/socket.h>
 #include <unistd.h>
 
 void UserState::readOpts(int argc, char *argv[]) {
     int opt;
-    while ((opt = getopt(argc, argv, "n:p:h")) != -1) {
+    while ((opt = getopt(argc, argv, "n:p:t:r:s:b:j:h")) != -1) {
         switch (opt) {
         case 'n':
             this->host = std::string(optarg);
@@ -19,6 +22,31 @@ void UserState::readOpts(int argc, char *argv[]) {
         case 'p':
             this->port = std::string(optarg);
             break;
+        case 't':
+            if (toInt(optarg, this->rto) || this->rto == 0) {
+                printHelp(std::cerr, argv[0]);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 'r':
+            if (toInt(optarg, this->retries)) {
+                printHelp(std::cerr, argv[0]);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 's':
+            this->script = std::string(optarg);
+            break;
+        case 'b':
+            this->script = std::string(optarg);
+            this->json = true;
+            break;
+        case 'j':
+            if (toInt(optarg, this->parallelism) || this->parallelism == 0) {
+                printHelp(std::cerr, argv[0]);
+                exit(EXIT_FAILURE);
+            }
+            break;
         case 'h':
             printHelp(std::cout, argv[0]);
             exit(EXIT_SUCCESS);
@@ -44,26 +72,38 @@ void UserState::openUDPSocket() {
     }
 }
 
-int UserState::openTCPSocket() {
-    if ((this->socketTCP = socket(AF_INET, SOCK_STREAM, 0)) == -1) {
+int UserState::connectTCPSocket() {
+    int fd;
+    if ((fd = socket(AF_INET, SOCK_STREAM, 0)) == -1) {
         std::cerr << SOCKET_CREATE_ERR << strerror(errno) << std::endl;
-        return 1;
+        return -1;
     }
     struct timeval timeout;
     memset(&timeout, 0, sizeof(timeout));
     timeout.tv_sec = READ_TIMEOUT_SECS;
-    if (setsockopt(this->socketTCP, SOL_SOCKET, SO_RCVTIMEO, &timeout,
-                   sizeof(timeout)) != 0) {
+    if (setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) !=
+        0) {
+        close(fd);
         std::cerr << SOCKET_TIMEOUT_ERR << strerror(errno) << std::endl;
-        return 1;
+        return -1;
     }
     timeout.tv_sec = WRITE_TIMEOUT_SECS;
-    if (setsockopt(this->socketTCP, SOL_SOCKET, SO_SNDTIMEO, &timeout,
-                   sizeof(timeout)) != 0) {
+    if (setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout)) !=
+        0) {
+        close(fd);
         std::cerr << SOCKET_TIMEOUT_ERR << strerror(errno) << std::endl;
-        return 1;
+        return -1;
     }
-    return 0;
+    if (connect(fd, this->addrTCP->ai_addr, this->addrTCP->ai_addrlen) == -1) {
+        close(fd);
+        std::cerr << TCP_CONNECT_ERR << std::endl;
+        return -1;
+    }
+    return fd;
+}
+
+int UserState::openTCPSocket() {
+    return (this->socketTCP = this->connectTCPSocket()) == -1;
 }
 
 int UserState::closeTCPSocket() {
@@ -104,35 +144,68 @@ void UserState::getServerAddresses() {
 }
 
 int UserState::sendAndReceiveUDPPacket(UDPPacket &packetOut,
-                                       UDPPacket &packetIn, size_t lim) {
+                                       UDPPacket &packetIn, size_t lim,
+                                       const char *replyID) {
+    const struct sockaddr_in *server =
+        (const struct sockaddr_in *)this->addrUDP->ai_addr;
+    std::string request = packetOut.serialize();
     std::string response;
-    if (sendUDPPacket(packetOut, this->addrUDP->ai_addr,
-                      this->addrUDP->ai_addrlen, this->socketUDP)) {
-        return 1;
-    }
-    if (receiveUDPPacket(response, this->addrUDP->ai_addr,
-                         &this->addrUDP->ai_addrlen, this->socketUDP, lim)) {
-        return 1;
+
+    // Late replies to earlier requests would be taken for this one
+    char stale;
+    while (recv(this->socketUDP, &stale, 1, MSG_DONTWAIT) >= 0) {
     }
-    if (packetIn.deserialize(response)) {
-        std::cerr << PACKET_ERR << std::endl;
-        return 1;
+
+    uint32_t timeout = this->rto;
+    for (uint32_t attempt = 0; attempt <= this->retries; ++attempt) {
+        if (sendUDPMessage(request, this->addrUDP->ai_addr,
+                           this->addrUDP->ai_addrlen, this->socketUDP)) {
+            return 1;
+        }
+        std::uniform_int_distribution<uint32_t> jitter(
+            timeout - timeout / 4, timeout + timeout / 4);
+        auto deadline = std::chrono::steady_clock::now() +
+                        std::chrono::milliseconds(jitter(this->rng));
+        struct pollfd pfd = {this->socketUDP, POLLIN, 0};
+        int64_t wait;
+        while ((wait = std::chrono::duration_cast<std::chrono::milliseconds>(
+                           deadline - std::chrono::steady_clock::now())
+                           .count()) > 0) {
+            int ready = poll(&pfd, 1, (int)wait);
+            if (ready == -1 && errno == EINTR) {
+                return 1; // the user is leaving
+            } else if (ready <= 0) {
+                break;
+            }
+            struct sockaddr_in from;
+            socklen_t fromlen = sizeof(from);
+            if (receiveUDPPacket(response, (struct sockaddr *)&from,
+                                 &fromlen, this->socketUDP, lim)) {
+                return 1;
+            }
+            if (from.sin_addr.s_addr != server->sin_addr.s_addr ||
+                from.sin_port != server->sin_port ||
+                (response.compare(0, PACKET_ID_LEN, replyID) != 0 &&
+                 response.compare(0, PACKET_ID_LEN, "ERR") != 0)) {
+                continue; // not the reply to this request
+            }
+            if (packetIn.deserialize(response)) {
+                std::cerr << PACKET_ERR << std::endl;
+                return 1;
+            }
+            return 0;
+        }
+        timeout = std::min(timeout * 2, std::max(this->rto, UDP_MAX_RTO_MS));
     }
-    return 0;
+    std::cerr << UDP_TIMEOUT_ERR << std::endl;
+    return 1;
 }
 
 int UserState::sendAndReceiveTCPPacket(TCPPacket &packetOut,
-                                       TCPPacket &packetIn) {
-    std::string response;
+                                       TCPPacket &packetIn, bool keepOpen) {
     if (this->openTCPSocket()) {
         return 1;
     }
-    if (connect(this->socketTCP, this->addrTCP->ai_addr,
-                this->addrTCP->ai_addrlen) == -1) {
-        this->closeTCPSocket();
-        std::cerr << TCP_CONNECT_ERR << std::endl;
-        return 1;
-    }
     if (packetOut.serialize(this->socketTCP)) {
         this->closeTCPSocket();
         return 1;
@@ -142,7 +215,17 @@ int UserState::sendAndReceiveTCPPacket(TCPPacket &packetOut,
         std::cerr << PACKET_ERR << std::endl;
         return 1;
     }
-    return this->closeTCPSocket();
+    return keepOpen ? 0 : this->closeTCPSocket();
+}
+
+int UserState::exchangeTCPPacket(TCPPacket &packetOut, TCPPacket &packetIn) {
+    int fd = this->connectTCPSocket();
+    if (fd == -1) {
+        return 1;
+    }
+    int res = packetOut.serialize(fd) || packetIn.deserialize(fd);
+    close(fd);
+    return res;
 }
 
 UserState::~UserState() {
@@ -4,6 +4,14 @@
 #include "../lib/constants.hpp"
 #include "../lib/protocol.hpp"
 
+#include <random>
+#include <unordered_map>
+
+typedef struct {
+    RRCPacket record;
+    uint32_t seq; // number of bids of the auction seen so far
+} CachedRecord;
+
 class UserState {
   public:
     std::string host = DEFAULT_AS_HOST;
@@ -14,6 +22,12 @@ class UserState {
     struct addrinfo *addrTCP = NULL;
     int socketUDP = -1;
     int socketTCP = -1; // current, if any
+    uint32_t rto = UDP_RTO_MS;
+    uint32_t retries = UDP_RETRIES;
+    std::mt19937 rng{std::random_device{}()}; // jitter of the retransmissions
+    std::string script; // run instead of reading the commands, if given
+    bool json = false;  // results of the script as JSON lines
+    uint32_t parallelism = BATCH_PARALLELISM;
 
     bool shutDown = false;
 
@@ -23,14 +37,33 @@ class UserState {
     std::string UID;
     std::string password;
 
+    // records already shown, by AID
+    std::unordered_map<std::string, CachedRecord> records;
+
     void readOpts(int argc, char *argv[]);
     void getServerAddresses();
     void openUDPSocket();
+    // Returns a socket connected to the server, or -1. It leaves socketTCP
+    // alone, so that many threads can use it at once.
+    int connectTCPSocket();
     int openTCPSocket();
     int closeTCPSocket();
+    // Retransmits the request until a reply of the expected packet (or ERR)
+    // arrives from the server, waiting rto milliseconds at first and twice as
+    // long on each retry, give or take a quarter
     int sendAndReceiveUDPPacket(UDPPacket &packetOut, UDPPacket &packetIn,
-                                size_t lim);
-    int sendAndReceiveTCPPacket(TCPPacket &packetOut, TCPPacket &packetIn);
+                                size_t lim, const char *replyID);
+    template <class Packet>
+    int sendAndReceiveUDPPacket(UDPPacket &packetOut, Packet &packetIn,
+                                size_t lim) {
+        return sendAndReceiveUDPPacket(packetOut, packetIn, lim, Packet::ID);
+    }
+    // With keepOpen the socket is left open after the reply, for what the
+    // server sends next
+    int sendAndReceiveTCPPacket(TCPPacket &packetOut, TCPPacket &packetIn,
+                                bool keepOpen = false);
+    // Like sendAndReceiveTCPPacket, over a socket of its own
+    int exchangeTCPPacket(TCPPacket &packetOut, TCPPacket &packetIn);
     ~UserState();
 };
 
@@ -0,0 +1,71 @@
+#!/bin/bash
+# Uploads an asset in two chunks to a local server, then sends the first one
+# again with a corrupted byte. The corrupted copy must not count: OPC has to
+# answer NOK until that chunk is sent right once more.
+
+MY_PORT=58076
+UID_PASS="103124 pass1234"
+
+RED='\033[0;31m'
+GREEN='\033[0;32m'
+NC='\033[0m' # stands for No Color
+
+if [ ! -s ../AS ]; then
+    echo "ERR: Make sure to run 'make' on the root project directory."
+    exit 1
+fi
+
+DATA_DIR=$(mktemp -d)
+../AS -p $MY_PORT -d "$DATA_DIR" > /dev/null &
+SERVER_PID=$!
+# Both processes of the server stop on SIGINT
+trap 'pkill -INT -P $SERVER_PID; kill -INT $SERVER_PID; wait $SERVER_PID
+      rm -rf "$DATA_DIR"' EXIT
+sleep 0.5
+
+# Sends a request and prints the first line of the reply
+request() {
+    exec 3<> /dev/"$1"/127.0.0.1/$MY_PORT || return
+    printf '%s\n' "$2" >&3
+    read -r -t 5 reply <&3
+    exec 3<&-
+    echo "$reply"
+}
+
+# The CRC-32 of the data, which gzip keeps at the end of what it writes
+crc() {
+    printf '%s' "$1" | gzip -c | tail -c8 | head -c4 | od -An -tx4 | tr -d ' \n'
+}
+
+FAILED=0
+expect() {
+    if [ "$2" = "$3" ]; then
+        echo -e "$1: ${GREEN}$2${NC}"
+    else
+        echo -e "$1: ${RED}got '$2', expected '$3'${NC}"
+        FAILED=1
+    fi
+}
+
+FIRST=abcdefghij
+SECOND=klmnopqrst
+request udp "LIN $UID_PASS" > /dev/null
+read -r _ status token <<< "$(request tcp "UPS $UID_PASS 20")"
+expect "UPS" "$status" "OK"
+expect "first chunk" "$(request tcp "UPC $token 0 10 $(crc $FIRST) $FIRST")" \
+    "RUC OK"
+expect "second chunk" \
+    "$(request tcp "UPC $token 10 10 $(crc $SECOND) $SECOND")" "RUC OK"
+expect "corrupted first chunk" \
+    "$(request tcp "UPC $token 0 10 $(crc $FIRST) abcdeXghij")" "RUC CRC"
+expect "OPC" \
+    "$(request tcp "OPC $UID_PASS upload 100 60 asset.txt $token")" "ROA NOK"
+expect "first chunk again" \
+    "$(request tcp "UPC $token 0 10 $(crc $FIRST) $FIRST")" "RUC OK"
+read -r _ status AID <<< \
+    "$(request tcp "OPC $UID_PASS upload 100 60 asset.txt $token")"
+expect "OPC" "$status" "OK"
+expect "asset of $AID" "$(find "$DATA_DIR" -name asset.txt -exec cat {} \;)" \
+    "$FIRST$SECOND"
+
+exit $FAILED